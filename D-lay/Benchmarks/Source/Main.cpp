@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/Benchmarks.h"
+#include <iostream>
+
+//Runs the Benchmarks grid and writes the JSON document to a file
+//the Release configuration measures the SIMD build and the Scalar configuration (JUCE_USE_SIMD=0) the scalar one
+//  [results.json] (defaults to benchmarks_simd.json or benchmarks_scalar.json in the working directory)
+int main(int argc, char* argv[])
+{
+	//processors post their host notifications as messages, so there must be a message manager (messages are never dispatched)
+	const ScopedJuceInitialiser_GUI juce;
+
+	const File output = File::getCurrentWorkingDirectory().getChildFile(argc > 1 ? String(CharPointer_UTF8(argv[1]))
+		: JUCE_USE_SIMD ? "benchmarks_simd.json" : "benchmarks_scalar.json");
+	std::cout << "running benchmarks..." << std::endl;
+	if (!output.replaceWithText(Benchmarks::runToJSON({})))
+	{
+		std::cout << "cannot write " << output.getFullPathName() << std::endl;
+		return 1;
+	}
+	std::cout << "wrote " << output.getFullPathName() << std::endl;
+	return 0;
+}
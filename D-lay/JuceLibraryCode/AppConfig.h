@@ -18,6 +18,14 @@
 
 // (You can add your own code in this section, and the Projucer will not overwrite it)
 
+//the Bank configurations (DLAY_VOICE_BANK=1) build VoiceBankProcessor as its own plugin instead of D-lay
+#if DLAY_VOICE_BANK
+ #define JucePlugin_Name                   "D-lay Voice Bank"
+ #define JucePlugin_Desc                   "D-lay Voice Bank"
+ #define JucePlugin_PluginCode             0x53396b62 // 'S9kb'
+ #define JucePlugin_WantsMidiInput         0
+#endif
+
 // [END_USER_CODE_SECTION]
 
 /*
@@ -376,7 +384,7 @@
  #define JucePlugin_IsSynth                0
 #endif
 #ifndef  JucePlugin_WantsMidiInput
- #define JucePlugin_WantsMidiInput         0
+ #define JucePlugin_WantsMidiInput         1
 #endif
 #ifndef  JucePlugin_ProducesMidiOutput
  #define JucePlugin_ProducesMidiOutput     0
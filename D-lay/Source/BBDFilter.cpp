@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "BBDFilter.h"
+
+// BBDFilterCoefficients
+//==============================================================================
+
+void BBDFilterCoefficients::prepare(double sampleRate) noexcept
+{
+	mSampleRate = sampleRate;
+	mCoefficientsVersion = -1;
+	update();
+}
+
+void BBDFilterCoefficients::setCutoffFrequencyHz(float hzCutoff) noexcept
+{
+	jassert(hzCutoff > 0.0f);
+	mParameters.publish([hzCutoff](Parameters& parameters) { parameters.hzCutoff = hzCutoff; });
+}
+
+void BBDFilterCoefficients::setResonance(float resonance) noexcept
+{
+	jassert(resonance >= 0.0f && resonance <= 1.0f);
+	mParameters.publish([resonance](Parameters& parameters) { parameters.resonance = resonance; });
+}
+
+void BBDFilterCoefficients::computeCoefficients(float hzCutoff, float resonance) noexcept
+{
+	//same design as the header-only core so both filter identically
+	dlay::designBBDFilter(hzCutoff, resonance, mSampleRate, mDoubleCoefficients);
+
+	for (int i = 0; i < numCoefficients; ++i)
+	{
+		mCoefficients[i] = static_cast<float> (mDoubleCoefficients[i]);
+#if JUCE_USE_SIMD
+		mSIMDCoefficients[i] = mCoefficients[i];
+		mDoubleSIMDCoefficients[i] = mDoubleCoefficients[i];
+#endif
+	}
+}
+
+// BBDFilter
+//==============================================================================
+
+template <typename SampleType>
+void BBDFilter<SampleType>::prepare(const dsp::ProcessSpec spec)
+{
+	//save spec
+	mBlockSize = static_cast<int> (spec.maximumBlockSize);
+	mNumChannels = static_cast<int> (spec.numChannels);
+
+#if JUCE_USE_SIMD
+	//prepare for channel interleaving: one SIMD state set per group of lanes
+	mInterleaver.prepare(mNumChannels, mBlockSize);
+	mState = dsp::AudioBlock<dsp::SIMDRegister<SampleType>>(stateData, 1, static_cast<size_t> (mInterleaver.getNumGroups() * stateSize));
+#else
+	mState.allocate(static_cast<size_t> (mNumChannels * stateSize), true);
+	mScratch.allocate(static_cast<size_t> (mBlockSize), true);
+#endif
+
+	reset();
+}
+
+template <typename SampleType>
+void BBDFilter<SampleType>::reset() noexcept
+{
+#if JUCE_USE_SIMD
+	mState.clear();
+#else
+	for (int i = 0; i < mNumChannels * stateSize; ++i)
+		mState[i] = 0;
+#endif
+}
+
+template class BBDFilter<float>;
+template class BBDFilter<double>;
@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SIMDInterleaver.h"
+#include "DlayCore.h"
+#include "ParameterSnapshot.h"
+
+//Shared coefficient engine for BBD filter stages: parameters are set from any thread and coefficients are recomputed once per change
+class BBDFilterCoefficients
+{
+public:
+
+	//biquad coefficients of one section normalised by a0 (order: b0, b1, b2, a1, a2)
+	enum { numSections = 2, coefficientsPerSection = 5, numCoefficients = numSections * coefficientsPerSection };
+
+	// Essential Methods
+	//==============================================================================
+
+	//save sample rate and force a coefficient update
+	void prepare(double sampleRate) noexcept;
+
+	//recompute cached coefficients if a parameter changed since the last call (audio thread, once per block before any stage runs)
+	void update() noexcept
+	{
+		const auto& parameters = mParameters.acquire();
+		if (mParameters.getVersion() == mCoefficientsVersion)
+			return;
+		mCoefficientsVersion = mParameters.getVersion();
+		computeCoefficients(parameters.hzCutoff, parameters.resonance);
+	}
+
+	//cached coefficients for the stages in either sample precision
+	template <typename SampleType>
+	const SampleType* getCoefficients() const noexcept
+	{
+		if constexpr (std::is_same<SampleType, float>::value)
+			return mCoefficients;
+		else
+			return mDoubleCoefficients;
+	}
+#if JUCE_USE_SIMD
+	template <typename SampleType>
+	const dsp::SIMDRegister<SampleType>* getSIMDCoefficients() const noexcept
+	{
+		if constexpr (std::is_same<SampleType, float>::value)
+			return mSIMDCoefficients;
+		else
+			return mDoubleSIMDCoefficients;
+	}
+#endif
+
+	// Parameters
+	//==============================================================================
+
+	//set Cutoff using Hz value > 0.0f (safe to call from any thread)
+	void setCutoffFrequencyHz(float hzCutoff) noexcept;
+
+	//set Resonance using value between 0.0f and 1.0f (safe to call from any thread)
+	void setResonance(float resonance) noexcept;
+
+private:
+
+	//design both sections from cutoff and resonance into mDoubleCoefficients, mCoefficients, and their broadcast SIMD copies
+	void computeCoefficients(float hzCutoff, float resonance) noexcept;
+
+	//cached coefficients (float and double)
+	float mCoefficients[numCoefficients] = {};
+	double mDoubleCoefficients[numCoefficients] = {};
+#if JUCE_USE_SIMD
+	dsp::SIMDRegister<float> mSIMDCoefficients[numCoefficients];
+	dsp::SIMDRegister<double> mDoubleSIMDCoefficients[numCoefficients];
+#endif
+	int mCoefficientsVersion = -1;
+
+	//processing parameters published as one coherent set, so a block never mixes a new cutoff with an old resonance (units: Hz, [0,1])
+	struct Parameters
+	{
+		float hzCutoff = 2500.0f, resonance = 0.3f;
+	};
+	ParameterSnapshot<Parameters> mParameters;
+
+	double mSampleRate = 44100.0;
+};
+
+//24dB/oct resonant low pass stage built from two cascaded Sallen-Key style biquads, like the filters around BBD chips
+//channels are packed into SIMD lanes; coefficients come from a (possibly shared) BBDFilterCoefficients engine
+template <typename SampleType>
+class BBDFilter
+{
+public:
+
+	explicit BBDFilter(const BBDFilterCoefficients& coefficients) noexcept : mCoefficients(coefficients) {}
+
+	// Essential Methods
+	//==============================================================================
+
+	//save environment variables, allocate interleaving memory, and clear state
+	void prepare(const dsp::ProcessSpec spec);
+
+	//clear filter state
+	void reset() noexcept;
+
+	//filter context (call after the coefficient engine's update)
+	template <typename ProcessContext>
+	void process(const ProcessContext& context) noexcept
+	{
+		const auto& inputBlock = context.getInputBlock();
+		auto& outputBlock = context.getOutputBlock();
+		if (context.isBypassed)
+		{
+			if (context.usesSeparateInputAndOutputBlocks())
+				outputBlock.copyFrom(inputBlock);
+			return;
+		}
+		jassert(inputBlock.getNumChannels() <= static_cast<size_t> (mNumChannels));
+
+		const int numSamples = static_cast<int> (outputBlock.getNumSamples());
+		const int numChannels = static_cast<int> (outputBlock.getNumChannels());
+#if JUCE_USE_SIMD
+		for (int group = 0; group * SIMDInterleaver<SampleType>::lanes < numChannels; ++group)
+		{
+			auto* interleaved = mInterleaver.interleave(group, inputBlock);
+			processSections(interleaved, numSamples, mState.getChannelPointer(0) + group * stateSize, mCoefficients.template getSIMDCoefficients<SampleType>());
+			mInterleaver.deinterleave(group, outputBlock);
+		}
+#else
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			if (context.usesSeparateInputAndOutputBlocks())
+				FloatVectorOperations::copy(outputBlock.getChannelPointer(channel), inputBlock.getChannelPointer(channel), numSamples);
+			processSections(outputBlock.getChannelPointer(channel), numSamples, mState.getData() + channel * stateSize, mCoefficients.template getCoefficients<SampleType>());
+		}
+#endif
+	}
+
+	//filter source and add it times gain to destination starting at destinationStart, in one pass over each (fused wet mix)
+	void processAdd(const SampleType* const* source, SampleType* const* destination, int numChannels, int destinationStart, int numSamples, SampleType gain) noexcept
+	{
+		jassert(numChannels <= mNumChannels && numSamples <= mBlockSize);
+#if JUCE_USE_SIMD
+		for (int group = 0; group * SIMDInterleaver<SampleType>::lanes < numChannels; ++group)
+		{
+			//interleave straight from source, filter all lanes at once, and deinterleave with gain straight into destination
+			auto* interleaved = mInterleaver.interleave(group, source, numChannels, numSamples);
+			processSections(interleaved, numSamples, mState.getChannelPointer(0) + group * stateSize, mCoefficients.template getSIMDCoefficients<SampleType>());
+			mInterleaver.deinterleaveAdd(group, destination, numChannels, destinationStart, numSamples, gain);
+		}
+#else
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			SampleType* scratch = mScratch.getData();
+			FloatVectorOperations::copy(scratch, source[channel], numSamples);
+			processSections(scratch, numSamples, mState.getData() + channel * stateSize, mCoefficients.template getCoefficients<SampleType>());
+			FloatVectorOperations::addWithMultiply(destination[channel] + destinationStart, scratch, gain, numSamples);
+		}
+#endif
+	}
+
+private:
+
+	enum { numSections = BBDFilterCoefficients::numSections, coefficientsPerSection = BBDFilterCoefficients::coefficientsPerSection, stateSize = numSections * 2 };
+
+	//run every section over data in place using transposed direct form II (Vec is SampleType or SIMDRegister<SampleType>)
+	template <typename Vec>
+	static void processSections(Vec* data, int numSamples, Vec* state, const Vec* coefficients) noexcept
+	{
+		for (int section = 0; section < numSections; ++section)
+		{
+			const Vec* c = coefficients + section * coefficientsPerSection;
+			const Vec b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+			Vec s1 = state[section * 2], s2 = state[section * 2 + 1];
+			for (int i = 0; i < numSamples; ++i)
+			{
+				const Vec x = data[i];
+				const Vec y = b0 * x + s1;
+				s1 = b1 * x - a1 * y + s2;
+				s2 = b2 * x - a2 * y;
+				data[i] = y;
+			}
+			state[section * 2] = s1;
+			state[section * 2 + 1] = s2;
+		}
+	}
+
+	//coefficient engine
+	const BBDFilterCoefficients& mCoefficients;
+
+	//filter state: s1 and s2 per section per channel (or per SIMD channel group)
+#if JUCE_USE_SIMD
+	dsp::AudioBlock<dsp::SIMDRegister<SampleType>> mState; //single aligned channel of stateSize registers per group
+	HeapBlock<char> stateData;
+	SIMDInterleaver<SampleType> mInterleaver;
+#else
+	HeapBlock<SampleType> mState, mScratch;
+#endif
+
+	//environment variables
+	int mBlockSize = 0, mNumChannels = 0;
+};
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "BBDNoise.h"
+
+void BBDNoise::prepare(const dsp::ProcessSpec spec)
+{
+	mSampleRate = spec.sampleRate;
+	mBufVersion = -1; //clock increment depends on sample rate
+	reset();
+}
+
+void BBDNoise::reset() noexcept
+{
+	mCounter = 0;
+	mClockPhase = 0;
+}
+
+void BBDNoise::setSeed(uint32 seed) noexcept
+{
+	mParameters.publish([seed](Parameters& parameters) { parameters.seed = seed; });
+}
+
+void BBDNoise::setHissLevel(float dbHiss) noexcept
+{
+	jassert(dbHiss <= 0.0f);
+	//uniform noise in [-1, 1) has an RMS of 1/sqrt(3)
+	mParameters.publish([dbHiss](Parameters& parameters) { parameters.hissAmplitude = Decibels::decibelsToGain(dbHiss) * std::sqrt(3.0f); });
+}
+
+void BBDNoise::setClockBleedLevel(float dbClockBleed) noexcept
+{
+	jassert(dbClockBleed <= 0.0f);
+	mParameters.publish([dbClockBleed](Parameters& parameters) { parameters.clockAmplitude = Decibels::decibelsToGain(dbClockBleed); });
+}
+
+void BBDNoise::setRate(float msRate) noexcept
+{
+	jassert(msRate >= 0.0f && msRate <= 1000.0f);
+	mParameters.publish([msRate](Parameters& parameters) { parameters.msRate = msRate; });
+}
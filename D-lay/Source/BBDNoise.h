@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DlayCore.h"
+#include "ParameterSnapshot.h"
+
+//BBD hiss and clock bleed: counter-based noise and an integer phase clock tone, both bit-reproducible for a given seed
+//output depends only on the seed, parameters, and number of samples since reset, never on block sizes or the machine
+class BBDNoise
+{
+public:
+
+	// Essential Methods
+	//==============================================================================
+
+	//save environment variables and restart the sample counter
+	void prepare(const dsp::ProcessSpec spec);
+
+	//restart the sample counter and clock phase
+	void reset() noexcept;
+
+	//add hiss and clock bleed to context in place (float or double)
+	template <typename ProcessContext>
+	void process(const ProcessContext& context) noexcept
+	{
+		using SampleType = typename ProcessContext::SampleType;
+		auto& block = context.getOutputBlock();
+		if (context.isBypassed)
+			return;
+		updateBufParams();
+		const auto hissAmplitude = static_cast<SampleType> (mBufHissAmplitude), clockAmplitude = static_cast<SampleType> (mBufClockAmplitude);
+
+		const int numSamples = static_cast<int> (block.getNumSamples());
+		for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+		{
+			SampleType* data = block.getChannelPointer(channel);
+			const uint32 key = mBufSeed ^ (static_cast<uint32> (channel + 1) * 0x9e3779b9u);
+			//hiss: every sample hashes (counter, key) independently, so there is no loop carried state and the loop vectorises
+			for (int i = 0; i < numSamples; ++i)
+			{
+				const uint32 hash = dlay::lowBias32(dlay::lowBias32((mCounter + static_cast<uint32> (i)) ^ key));
+				data[i] += hissAmplitude * (static_cast<SampleType> (static_cast<int32> (hash)) * static_cast<SampleType> (1.0 / 2147483648.0));
+			}
+			//clock bleed: triangle from a 32 bit phase accumulator, identical in every channel
+			if (mBufClockIncrement != 0)
+			{
+				uint32 phase = mClockPhase;
+				for (int i = 0; i < numSamples; ++i, phase += mBufClockIncrement)
+				{
+					const int32 folded = static_cast<int32> ((phase ^ static_cast<uint32> (static_cast<int32> (phase) >> 31)) - 0x40000000u); //|saw| - 1/2
+					data[i] += clockAmplitude * (static_cast<SampleType> (folded) * static_cast<SampleType> (1.0 / 1073741824.0));
+				}
+			}
+		}
+		mCounter += static_cast<uint32> (numSamples);
+		mClockPhase += mBufClockIncrement * static_cast<uint32> (numSamples);
+	}
+
+	// Parameters
+	//==============================================================================
+
+	//set Seed; equal seeds give bit identical noise
+	void setSeed(uint32 seed) noexcept;
+
+	//set hiss level using decibel RMS value <= 0.0f
+	void setHissLevel(float dbHiss) noexcept;
+
+	//set clock bleed level using decibel peak value <= 0.0f
+	void setClockBleedLevel(float dbClockBleed) noexcept;
+
+	//set clock from the emulated delay using ms value between 0.0f and 1000.0f (clock = stages / (2 * delay), silent above Nyquist)
+	void setRate(float msRate) noexcept;
+
+	//bucket count of the emulated BBD (MN3005)
+	static constexpr int numStages = 4096;
+
+private:
+
+	//called once per process: one snapshot acquire, the clock increment recomputed only when a new version was published
+	void updateBufParams() noexcept
+	{
+		const auto& parameters = mParameters.acquire();
+		if (mParameters.getVersion() == mBufVersion)
+			return;
+		mBufVersion = mParameters.getVersion();
+		mBufSeed = parameters.seed;
+		mBufHissAmplitude = parameters.hissAmplitude;
+		mBufClockAmplitude = parameters.clockAmplitude;
+
+		//two clock phases move a sample by one bucket
+		const double hzClock = (parameters.msRate > 0.0f) ? numStages / (2.0 * parameters.msRate / 1000.0) : 0.0;
+		mBufClockIncrement = (hzClock > 0.0 && hzClock < mSampleRate * 0.5) ? static_cast<uint32> (hzClock / mSampleRate * 4294967296.0) : 0;
+	}
+
+	//generator state
+	uint32 mCounter = 0, mClockPhase = 0;
+
+	//parameters derived from the snapshot version mBufVersion (-1 forces an update, e.g. after a sample rate change)
+	uint32 mBufSeed = 0, mBufClockIncrement = 0;
+	float mBufHissAmplitude = 0.0f, mBufClockAmplitude = 0.0f;
+	int mBufVersion = -1;
+
+	//processing parameters published as one coherent set (units: seed, gain, gain, ms)
+	struct Parameters
+	{
+		uint32 seed = 0x0d1a7;
+		float hissAmplitude = 0.0f, clockAmplitude = 0.0f, msRate = 150.0f;
+	};
+	ParameterSnapshot<Parameters> mParameters;
+
+	//environment variables
+	double mSampleRate = 44100.0;
+};
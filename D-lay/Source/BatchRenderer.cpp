@@ -0,0 +1,278 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+BatchRenderer::BatchRenderer(const Settings& settings) : mSettings(settings)
+{
+	mSettings.numWorkers = jmax(1, mSettings.numWorkers);
+	mSettings.blockSize = jmax(1, mSettings.blockSize);
+	//whole blocks per chunk, since the modular delay advances a block at a time (renders follow the block size)
+	mSettings.ioBlockSize = jmax(1, (mSettings.ioBlockSize + mSettings.blockSize - 1) / mSettings.blockSize) * mSettings.blockSize;
+	if (mSettings.preset.existsAsFile())
+		mPreset = XmlDocument::parse(mSettings.preset);
+	mFormatManager.registerBasicFormats();
+}
+
+BatchRenderer::Report BatchRenderer::render(const Array<Job>& jobs)
+{
+	Report report;
+	if (mSettings.preset != File() && mPreset == nullptr)
+	{
+		report.errors.add(mSettings.preset.getFullPathName() + ": could not parse preset");
+		report.numFailed = jobs.size();
+		return report;
+	}
+
+	//workers are created here so they never construct plugin state mid render
+	const int numWorkers = jmin(mSettings.numWorkers, jmax(1, jobs.size()));
+	report.numWorkers = numWorkers;
+	OwnedArray<Worker> workers;
+	for (int i = 0; i < numWorkers; ++i)
+	{
+		auto* worker = workers.add(new Worker());
+		auto& processor = worker->processor;
+		processor.setNonRealtime(true);
+		if (mPreset != nullptr)
+		{
+			MemoryBlock state;
+			AudioProcessor::copyXmlToBinary(*mPreset, state);
+			processor.setStateInformation(state.getData(), static_cast<int> (state.getSize()));
+		}
+		const int numChannels = jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+		for (auto& chunk : worker->chunks)
+			chunk.setSize(numChannels, mSettings.ioBlockSize);
+	}
+
+	mWriterThread.startThread();
+	Atomic<int> nextJob = 0, numFailed = 0;
+	CriticalSection reportLock;
+	const int64 start = Time::getHighResolutionTicks();
+	{
+		ThreadPool pool(numWorkers);
+		for (int worker = 0; worker < numWorkers; ++worker)
+		{
+			pool.addJob([&, worker]()
+			{
+				//pull files until none are left
+				for (int index = (++nextJob) - 1; index < jobs.size(); index = (++nextJob) - 1)
+				{
+					FileStats stats;
+					const String error = renderFile(jobs.getReference(index), *workers[worker], stats);
+					const ScopedLock lock(reportLock);
+					if (error.isEmpty())
+					{
+						++report.numRendered;
+						report.numMapped += stats.mapped ? 1 : 0;
+						report.audioSeconds += stats.audioSeconds;
+						report.readSeconds += stats.readSeconds;
+						report.bytesRead += stats.bytesRead;
+						report.bytesWritten += stats.bytesWritten;
+					}
+					else
+					{
+						++report.numFailed;
+						report.errors.add(jobs.getReference(index).input.getFullPathName() + ": " + error);
+					}
+				}
+			});
+		}
+		while (pool.getNumJobs() > 0)
+			Thread::sleep(10);
+	}
+	report.wallSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+	mWriterThread.stopThread(-1);
+	return report;
+}
+
+std::unique_ptr<AudioFormatReader> BatchRenderer::createReader(const File& file, bool& mapped)
+{
+	//mapped reads skip the stream layer: samples are converted straight out of the page cache into the chunk
+	mapped = false;
+	if (auto* format = mFormatManager.findFormatForFileExtension(file.getFileExtension()))
+	{
+		std::unique_ptr<MemoryMappedAudioFormatReader> mappedReader(format->createMemoryMappedReader(file));
+		if (mappedReader != nullptr && mappedReader->mapEntireFile())
+		{
+			mapped = true;
+			return std::move(mappedReader);
+		}
+	}
+	return std::unique_ptr<AudioFormatReader>(mFormatManager.createReaderFor(file));
+}
+
+BatchRenderer::ChunkReader::ChunkReader() : Thread("D-lay batch reader")
+{
+	startThread();
+}
+
+BatchRenderer::ChunkReader::~ChunkReader()
+{
+	signalThreadShouldExit();
+	mRequested.signal();
+	stopThread(-1);
+}
+
+void BatchRenderer::ChunkReader::request(AudioFormatReader& reader, AudioBuffer<float>& buffer, int numSamples, int64 startSample) noexcept
+{
+	mReader = &reader;
+	mBuffer = &buffer;
+	mNumSamples = numSamples;
+	mStartSample = startSample;
+	mRequested.signal();
+}
+
+double BatchRenderer::ChunkReader::wait() noexcept
+{
+	mFinished.wait();
+	return Time::highResolutionTicksToSeconds(mReadTicks);
+}
+
+void BatchRenderer::ChunkReader::run()
+{
+	//the events order the request's fields and the read buffer between this thread and the worker
+	while (!threadShouldExit())
+	{
+		mRequested.wait();
+		if (threadShouldExit())
+			break;
+		const int64 start = Time::getHighResolutionTicks();
+		mReader->read(mBuffer, 0, mNumSamples, mStartSample, true, true);
+		mReadTicks = Time::getHighResolutionTicks() - start;
+		mFinished.signal();
+	}
+}
+
+String BatchRenderer::renderFile(const Job& job, Worker& worker, FileStats& stats)
+{
+	//open input
+	std::unique_ptr<AudioFormatReader> reader = createReader(job.input, stats.mapped);
+	if (reader == nullptr)
+		return "unsupported or unreadable file";
+	auto& processor = worker.processor;
+	auto& chunks = worker.chunks;
+	const int numChannels = chunks[0].getNumChannels();
+	if (static_cast<int> (reader->numChannels) > numChannels)
+		return "more than " + String(numChannels) + " channels";
+
+	//open output (FileOutputStream appends, so start from an empty file)
+	if (!job.output.getParentDirectory().createDirectory() || (job.output.exists() && !job.output.deleteFile()))
+		return "cannot replace " + job.output.getFullPathName();
+	auto stream = std::make_unique<FileOutputStream>(job.output, static_cast<size_t> (mSettings.writeBufferBytes));
+	if (!stream->openedOk())
+		return "cannot write " + job.output.getFullPathName();
+	WavAudioFormat wav;
+	AudioFormatWriter* writer = wav.createWriterFor(stream.get(), reader->sampleRate, reader->numChannels, mSettings.bitsPerSample, {}, 0);
+	if (writer == nullptr)
+		return "cannot create a " + String(mSettings.bitsPerSample) + " bit WAV writer";
+	stream.release(); //owned by writer
+	//writes are queued and flushed on mWriterThread; the destructor flushes the rest
+	AudioFormatWriter::ThreadedWriter threadedWriter(writer, mWriterThread, mSettings.ioBlockSize * 2);
+
+	//every file starts from a clean state at its own sample rate
+	processor.setRateAndBufferSize(reader->sampleRate, mSettings.blockSize);
+	processor.prepareToPlay(reader->sampleRate, mSettings.blockSize);
+
+	//reads past the end of the file are zero filled, which pads the last block
+	const int chunkSize = mSettings.ioBlockSize;
+	const int64 length = reader->lengthInSamples;
+	MidiBuffer midi;
+	double readSeconds = 0.0;
+	size_t chunk = 0;
+	if (length > 0)
+		worker.reader.request(*reader, chunks[0], chunkSize, 0);
+	for (int64 start = 0; start < length; start += chunkSize, chunk ^= 1)
+	{
+		//wait for this chunk and start reading the next one into the other buffer
+		readSeconds += worker.reader.wait();
+		if (start + chunkSize < length)
+			worker.reader.request(*reader, chunks[chunk ^ 1], chunkSize, start + chunkSize);
+
+		//process
+		auto& current = chunks[chunk];
+		const int numValid = static_cast<int> (jmin(static_cast<int64> (chunkSize), length - start));
+		for (int position = 0; position < numValid; position += mSettings.blockSize)
+		{
+			AudioBuffer<float> block(current.getArrayOfWritePointers(), numChannels, position, mSettings.blockSize);
+			processor.processBlock(block, midi);
+		}
+
+		//queue the write (copied into the writer's FIFO, so the chunk can be reused right away)
+		while (!threadedWriter.write(current.getArrayOfReadPointers(), numValid))
+			Thread::sleep(1);
+	}
+	processor.releaseResources();
+
+	stats.audioSeconds = static_cast<double> (length) / reader->sampleRate;
+	stats.readSeconds = readSeconds;
+	stats.bytesRead = length * reader->numChannels * reader->bitsPerSample / 8;
+	stats.bytesWritten = length * reader->numChannels * mSettings.bitsPerSample / 8;
+	return {};
+}
+
+int BatchRenderer::runFromCommandLine(const StringArray& arguments)
+{
+	auto getValue = [&arguments](StringRef option) -> String
+	{
+		const int index = arguments.indexOf(option);
+		return (index >= 0 && index + 1 < arguments.size()) ? arguments[index + 1] : String();
+	};
+
+	Settings settings;
+	const StringArray valueOptions{ "--preset", "--workers", "--block", "--bits", "--out" };
+	if (getValue("--workers").isNotEmpty())
+		settings.numWorkers = getValue("--workers").getIntValue();
+	if (getValue("--block").isNotEmpty())
+		settings.blockSize = getValue("--block").getIntValue();
+	if (getValue("--bits").isNotEmpty())
+		settings.bitsPerSample = getValue("--bits").getIntValue();
+	if (getValue("--preset").isNotEmpty())
+		settings.preset = File::getCurrentWorkingDirectory().getChildFile(getValue("--preset"));
+	const File outputDirectory = File::getCurrentWorkingDirectory().getChildFile(getValue("--out"));
+	if (getValue("--out").isEmpty())
+	{
+		Logger::writeToLog("usage: [--preset state.xml] [--workers n] [--block n] [--bits 16|24|32] --out directory inputs...");
+		return 1;
+	}
+
+	//inputs are every argument that is not an option or an option's value (directories are searched for audio files)
+	BatchRenderer renderer(settings);
+	const String extensions = renderer.mFormatManager.getWildcardForAllFormats();
+	Array<Job> jobs;
+	for (int i = 0; i < arguments.size(); ++i)
+	{
+		if (valueOptions.contains(arguments[i]))
+		{
+			++i;
+			continue;
+		}
+		const File input = File::getCurrentWorkingDirectory().getChildFile(arguments[i]);
+		if (input.isDirectory())
+		{
+			for (const auto& file : input.findChildFiles(File::findFiles, true, extensions))
+				jobs.add({ file, outputDirectory.getChildFile(file.getRelativePathFrom(input)).withFileExtension("wav") });
+		}
+		else if (input.existsAsFile())
+		{
+			jobs.add({ input, outputDirectory.getChildFile(input.getFileName()).withFileExtension("wav") });
+		}
+	}
+
+	const auto report = renderer.render(jobs);
+	for (const auto& error : report.errors)
+		Logger::writeToLog(error);
+	Logger::writeToLog(String(report.numRendered) + " rendered, " + String(report.numFailed) + " failed, "
+		+ String(report.audioSeconds) + "s of audio in " + String(report.wallSeconds) + "s: "
+		+ String(report.getRealtimeMultiple()) + "x realtime, "
+		+ String(report.getRealtimeMultiplePerCore()) + "x per core");
+	Logger::writeToLog(String(report.numMapped) + " inputs memory mapped, " + String(report.bytesRead / 1000000) + "MB read at "
+		+ String(report.getReadThroughput()) + "MB/s per reader, " + String(report.bytesWritten / 1000000) + "MB written");
+	return report.numFailed == 0 ? 0 : 1;
+}
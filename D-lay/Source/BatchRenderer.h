@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include <array>
+
+//Offline renders of many files through the D-lay chain without a host
+//files are spread across a pool of workers, each reusing one DlayAudioProcessor; reads are double buffered on a reader thread per worker and
+//writes are asynchronous. Progress and errors go to the current Logger
+class BatchRenderer
+{
+public:
+
+	//one file to render
+	struct Job
+	{
+		File input, output;
+	};
+
+	struct Settings
+	{
+		int numWorkers = SystemStats::getNumCpus();
+		int blockSize = 512; //processBlock size
+		int ioBlockSize = 65536; //samples per read and write (rounded up to whole blocks)
+		int writeBufferBytes = 1 << 20; //output stream buffer, so the writer thread flushes in large writes
+		int bitsPerSample = 24; //output WAV bit depth (32 writes float)
+		File preset; //APVTS XML state (as saved by getStateInformation) or empty for defaults
+	};
+
+	//aggregate throughput of a render
+	struct Report
+	{
+		int numRendered = 0, numFailed = 0, numWorkers = 0, numMapped = 0;
+		double audioSeconds = 0.0, wallSeconds = 0.0;
+		StringArray errors;
+
+		//sample data read from and written to disk, and time spent in reads (summed over workers)
+		int64 bytesRead = 0, bytesWritten = 0;
+		double readSeconds = 0.0;
+
+		//input conversion throughput in MB/s of sample data
+		double getReadThroughput() const noexcept { return readSeconds > 0.0 ? static_cast<double> (bytesRead) / (readSeconds * 1.0e6) : 0.0; }
+
+		//seconds of audio rendered per second, in total and per worker
+		double getRealtimeMultiple() const noexcept { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+		double getRealtimeMultiplePerCore() const noexcept { return getRealtimeMultiple() / jmax(1, numWorkers); }
+	};
+
+	explicit BatchRenderer(const Settings& settings);
+
+	//render every job and block until all are done
+	Report render(const Array<Job>& jobs);
+
+	//command line front end for the console tools (Tools/D-lay Tools.jucer):
+	//  [--preset state.xml] [--workers n] [--block n] [--bits 16|24|32] --out directory inputs...
+	//returns the process exit code
+	static int runFromCommandLine(const StringArray& arguments);
+
+private:
+
+	//per file contribution to Report
+	struct FileStats
+	{
+		double audioSeconds = 0.0, readSeconds = 0.0;
+		int64 bytesRead = 0, bytesWritten = 0;
+		bool mapped = false;
+	};
+
+	//reads chunks on its own thread for the whole render, so a worker's next read overlaps its processing of the current chunk
+	class ChunkReader : public Thread
+	{
+	public:
+		ChunkReader();
+		~ChunkReader() override;
+
+		//start reading numSamples from startSample into buffer (reads past the end are zero filled); wait() before the next request
+		void request(AudioFormatReader& reader, AudioBuffer<float>& buffer, int numSamples, int64 startSample) noexcept;
+
+		//block until the last request has been read and return the seconds the read took
+		double wait() noexcept;
+
+	private:
+		void run() override;
+
+		WaitableEvent mRequested, mFinished;
+		AudioFormatReader* mReader = nullptr;
+		AudioBuffer<float>* mBuffer = nullptr;
+		int mNumSamples = 0;
+		int64 mStartSample = 0, mReadTicks = 0;
+	};
+
+	//what each worker reuses from file to file: a processor, a pair of chunk buffers (one processed while the other is read), and a reader
+	struct Worker
+	{
+		DlayAudioProcessor processor;
+		std::array<AudioBuffer<float>, 2> chunks;
+		ChunkReader reader;
+	};
+
+	//open a reader, memory mapping the whole file when its format supports it (WAV and AIFF)
+	std::unique_ptr<AudioFormatReader> createReader(const File& file, bool& mapped);
+
+	//render one file with a worker; returns an error message or an empty string
+	String renderFile(const Job& job, Worker& worker, FileStats& stats);
+
+	Settings mSettings;
+	std::unique_ptr<XmlElement> mPreset;
+
+	AudioFormatManager mFormatManager;
+	TimeSliceThread mWriterThread{ "D-lay batch writer" };
+};
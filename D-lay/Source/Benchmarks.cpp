@@ -0,0 +1,681 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "Benchmarks.h"
+
+var Benchmarks::run(const Config& config)
+{
+	Array<var> results;
+	runState(config.numStateInstances, results);
+	for (auto sampleRate : config.sampleRates)
+	{
+		for (auto numChannels : config.channelCounts)
+		{
+			for (auto blockSize : config.blockSizes)
+			{
+				const Case c{ blockSize, numChannels, sampleRate };
+				runDelayLine(c, config.minSeconds, results);
+				runSideChain(c, config.minSeconds, results);
+				runWaveshapers(c, config.minSeconds, results);
+				runFilters(c, config.minSeconds, results);
+				runPrecision(c, config.minSeconds, results);
+				runEngines(c, config.minSeconds, results);
+				runVoiceBank(c, config.minSeconds, results);
+				runAutomation(c, config.minSeconds, results);
+				runCrossfade(c, config.minSeconds, results);
+				runAntialiasing(c, config.minSeconds, results);
+			}
+		}
+	}
+	return results;
+}
+
+String Benchmarks::runToJSON(const Config& config)
+{
+	DynamicObject::Ptr root = new DynamicObject();
+#if JUCE_USE_SIMD
+	root->setProperty("simd", true);
+#else
+	root->setProperty("simd", false);
+#endif
+	root->setProperty("results", run(config));
+	return JSON::toString(var(root.get()));
+}
+
+var Benchmarks::makeResult(const String& component, const String& variant, const Case& c, double nsPerSample, double bytesPerSample)
+{
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("component", component);
+	result->setProperty("variant", variant);
+	result->setProperty("blockSize", c.blockSize);
+	result->setProperty("numChannels", c.numChannels);
+	result->setProperty("sampleRate", c.sampleRate);
+	result->setProperty("nsPerSample", nsPerSample);
+	result->setProperty("bytesPerSample", bytesPerSample);
+	//bytes per ns is GB/s, to compare against the machine's memory bandwidth
+	result->setProperty("gbPerSecond", nsPerSample > 0.0 ? bytesPerSample / nsPerSample : 0.0);
+	return var(result.get());
+}
+
+template <typename ProcessBlock>
+double Benchmarks::measure(const Case& c, double minSeconds, ProcessBlock&& processBlock)
+{
+	processBlock(); //warm up caches and tables
+	int64 numBlocks = 0;
+	const int64 start = Time::getHighResolutionTicks();
+	int64 elapsed = 0;
+	do
+	{
+		processBlock();
+		++numBlocks;
+		elapsed = Time::getHighResolutionTicks() - start;
+	} while (Time::highResolutionTicksToSeconds(elapsed) < minSeconds);
+	return Time::highResolutionTicksToSeconds(elapsed) * 1.0e9 / (static_cast<double> (numBlocks) * c.blockSize * c.numChannels);
+}
+
+template <typename ProcessBlock>
+double Benchmarks::measureAliasing(const Case& c, ProcessBlock&& processBlock)
+{
+	constexpr int order = 13, size = 1 << order;
+	const int numSettle = (roundToInt(0.25 * c.sampleRate) / c.blockSize + 1) * c.blockSize;
+	const int numBlocks = (numSettle + size + c.blockSize - 1) / c.blockSize;
+	const int bin = roundToInt(5000.0 * size / c.sampleRate);
+
+	//render, keeping the last size samples of the first channel
+	AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+	dsp::AudioBlock<float> block(buffer);
+	HeapBlock<float> spectrum(2 * size, true);
+	int64 n = 0;
+	for (int b = 0; b < numBlocks; ++b)
+	{
+		for (int i = 0; i < c.blockSize; ++i, ++n)
+			for (int channel = 0; channel < c.numChannels; ++channel)
+				buffer.setSample(channel, i, 0.9f * static_cast<float> (std::sin(MathConstants<double>::twoPi * bin * static_cast<double> (n % size) / size)));
+		processBlock(block);
+		const int first = static_cast<int> (n) - c.blockSize - (numBlocks * c.blockSize - size);
+		for (int i = jmax(0, -first); i < c.blockSize; ++i)
+			spectrum[first + i] = buffer.getSample(0, i);
+	}
+
+	dsp::WindowingFunction<float>(static_cast<size_t> (size), dsp::WindowingFunction<float>::hann, false).multiplyWithWindowingTable(spectrum, static_cast<size_t> (size));
+	dsp::FFT(order).performFrequencyOnlyForwardTransform(spectrum);
+
+	//harmonics below Nyquist (and the window's main lobe around them) against everything else but DC
+	double harmonic = 0.0, aliased = 0.0;
+	for (int k = 3; k <= size / 2; ++k)
+	{
+		const int nearest = roundToInt(static_cast<double> (k) / bin) * bin;
+		const double power = static_cast<double> (spectrum[k]) * spectrum[k];
+		(std::abs(k - nearest) <= 2 ? harmonic : aliased) += power;
+	}
+	return 10.0 * std::log10(jmax(aliased, 1.0e-30) / jmax(harmonic, 1.0e-30));
+}
+
+template <typename SampleType>
+void Benchmarks::fillNoise(AudioBuffer<SampleType>& buffer, Random& random) noexcept
+{
+	for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+		for (int i = 0; i < buffer.getNumSamples(); ++i)
+			buffer.setSample(channel, i, static_cast<SampleType> (0.5f * (random.nextFloat() * 2.0f - 1.0f)));
+}
+
+void Benchmarks::runDelayLine(const Case& c, double minSeconds, Array<var>& results)
+{
+	const dsp::ProcessSpec spec{ c.sampleRate, static_cast<uint32> (c.blockSize), static_cast<uint32> (c.numChannels) };
+	DelayLine<float> delayLine;
+	delayLine.prepare(spec);
+	delayLine.setFeedback(-6.0f);
+	delayLine.setWet(50);
+
+	//pick a rate that is not a multiple of the block size so the read segment wraps once per pass over the delay buffer
+	const int sampleRate = static_cast<int> (c.sampleRate);
+	float msRate = 333.0f;
+	int rate = static_cast<int> ((msRate / 1000.0f) * static_cast<float> (sampleRate));
+	while (rate % c.blockSize == 0)
+		rate = static_cast<int> (((msRate += 0.1f) / 1000.0f) * static_cast<float> (sampleRate));
+	delayLine.setRate(msRate);
+
+	//mirror DelayLine's positions to tell the branches apart
+	const int delayBufferLength = (sampleRate + c.blockSize) - (sampleRate % c.blockSize);
+	int writePosition = 0;
+
+	AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	int64 ticks[2] = {}, blocks[2] = {};
+	const int64 start = Time::getHighResolutionTicks();
+	//time each block on its own and keep going until both branches have enough blocks
+	while (blocks[0] < 32 || blocks[1] < 32 || Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) < minSeconds)
+	{
+		fillNoise(buffer, random);
+		delayLine.fillDelayBuffer(buffer);
+		const int readPosition = (delayBufferLength + writePosition - rate) % delayBufferLength;
+		const int wraps = (delayBufferLength - readPosition < c.blockSize) ? 1 : 0;
+
+		const int64 blockStart = Time::getHighResolutionTicks();
+		delayLine.getFromDelayBuffer(buffer);
+		ticks[wraps] += Time::getHighResolutionTicks() - blockStart;
+		++blocks[wraps];
+
+		writePosition += c.blockSize;
+		if (writePosition == delayBufferLength)
+			writePosition = 0;
+	}
+
+	//feedback (read source, read/write destination) + wet (read source, read/write buffer) + feedback sanitiser (read/write)
+	const double bytesPerSample = 8.0 * sizeof(float);
+	const char* variants[] = { "normal", "wrapAround" };
+	for (int wraps = 0; wraps < 2; ++wraps)
+	{
+		const double ns = Time::highResolutionTicksToSeconds(ticks[wraps]) * 1.0e9 / (static_cast<double> (blocks[wraps]) * c.blockSize * c.numChannels);
+		results.add(makeResult("DelayLine::getFromDelayBuffer", variants[wraps], c, ns, bytesPerSample));
+	}
+}
+
+void Benchmarks::runSideChain(const Case& c, double minSeconds, Array<var>& results)
+{
+#if JUCE_USE_SIMD
+	//the SIMD side chain packs every channel into one register
+	if (c.numChannels > static_cast<int> (dsp::SIMDRegister<float>::size()))
+		return;
+	const char* variant = "simd";
+	//interleave (read input, write scratch) + envelope (read/write scratch) + deinterleave (read scratch, write side chain)
+	const double bytesPerSample = 6.0 * sizeof(float);
+#else
+	const char* variant = "scalar";
+	//read input, read/write side chain
+	const double bytesPerSample = 3.0 * sizeof(float);
+#endif
+	const dsp::ProcessSpec spec{ c.sampleRate, static_cast<uint32> (c.blockSize), static_cast<uint32> (c.numChannels) };
+	DynamicWaveshaper<float> waveshaper;
+	waveshaper.prepare(spec);
+	waveshaper.setThreshold(-12.0f);
+
+	AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(buffer, random);
+	dsp::AudioBlock<float> block(buffer);
+	const dsp::ProcessContextReplacing<float> context(block);
+
+	//the chunk gate, then the sliding detectors per channel and stereo linked (they also read and write their window, and Peak its suffix
+	//maxima once per chunk)
+	const std::pair<int, const char*> detectors[] = { { DynamicWaveshaper<float>::chunkGate, "" }, { DynamicWaveshaper<float>::peak, " peak" },
+		{ DynamicWaveshaper<float>::rms, " rms" } };
+	for (const auto& detector : detectors)
+	{
+		for (int link = 0; link < (detector.first == DynamicWaveshaper<float>::chunkGate ? 1 : 2); ++link)
+		{
+			waveshaper.setDetector(detector.first);
+			waveshaper.setStereoLink(link != 0);
+			waveshaper.setKnee(detector.first == DynamicWaveshaper<float>::chunkGate ? 0.0f : 6.0f);
+			const double ns = measure(c, minSeconds, [&]() noexcept
+			{
+				waveshaper.updateBufParams();
+				waveshaper.updateSideChain(context.getInputBlock());
+			});
+			const double windowBytes = detector.first == DynamicWaveshaper<float>::chunkGate ? 0.0 : 3.0 * sizeof(float);
+			results.add(makeResult("DynamicWaveshaper::updateSideChain", String(variant) + detector.second + (link != 0 ? " linked" : ""), c, ns,
+				bytesPerSample + windowBytes));
+		}
+	}
+}
+
+void Benchmarks::runWaveshapers(const Case& c, double minSeconds, Array<var>& results)
+{
+#if JUCE_USE_SIMD
+	if (c.numChannels > static_cast<int> (dsp::SIMDRegister<float>::size()))
+		return;
+#endif
+	const dsp::ProcessSpec spec{ c.sampleRate, static_cast<uint32> (c.blockSize), static_cast<uint32> (c.numChannels) };
+	DynamicWaveshaper<float> waveshaper;
+	waveshaper.prepare(spec);
+	waveshaper.setThreshold(-12.0f);
+
+	AudioBuffer<float> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	dsp::AudioBlock<float> block(buffer);
+	const dsp::ProcessContextReplacing<float> context(block);
+
+	//restore input (read/write), side chain as above, then read input, side chain, and table and write output
+	const double bytesPerSample = 12.0 * sizeof(float);
+	const char* variants[] = { "linear", "bbd", "tube", "smashed" };
+	for (int choice = 0; choice < 4; ++choice)
+	{
+		waveshaper.setTargetWaveshaper(choice);
+		const double ns = measure(c, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			waveshaper.process(context);
+		});
+		results.add(makeResult("DynamicWaveshaper::process", variants[choice], c, ns, bytesPerSample));
+	}
+
+	//a morph between BBD and Tube looks up one blended table, so it should cost what a single shaper does
+	waveshaper.setTargetWaveshaper(1);
+	waveshaper.setCharacter(0.5f);
+	const double ns = measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		waveshaper.process(context);
+	});
+	results.add(makeResult("DynamicWaveshaper::process", "morph", c, ns, bytesPerSample));
+
+	//Lookahead writes and reads its buffer once per sample (two more reads/writes), whatever its length
+	waveshaper.setCharacter(0.0f);
+	const std::pair<float, const char*> lookaheads[] = { { 1.0f, "lookahead 1ms" }, { DynamicWaveshaper<float>::maxLookahead, "lookahead 10ms" } };
+	for (const auto& lookahead : lookaheads)
+	{
+		waveshaper.setLookahead(lookahead.first);
+		results.add(makeResult("DynamicWaveshaper::process", lookahead.second, c, measure(c, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			waveshaper.process(context);
+		}), bytesPerSample + 4.0 * sizeof(float)));
+	}
+
+	//an external key read in place from its own channels costs what keying from the input does (a mono key feeds every channel)
+	waveshaper.setLookahead(0.0f);
+	AudioBuffer<float> key(1, c.blockSize);
+	fillNoise(key, random);
+	waveshaper.setExternalKey(key.getArrayOfReadPointers(), key.getNumChannels());
+	results.add(makeResult("DynamicWaveshaper::process", "external key", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		waveshaper.process(context);
+	}), bytesPerSample));
+	waveshaper.setExternalKey(nullptr, 0);
+
+	//Bands split and detect as band lanes, one pass per group of lanes rather than per band (mono 3 bands fit one float group, stereo two),
+	//then shape every band channel; three full band instances are the reference they should beat
+	for (int bands = 2; bands <= DynamicWaveshaper<float>::maxBands; ++bands)
+	{
+		waveshaper.setBands(bands);
+		results.add(makeResult("DynamicWaveshaper::process", String(bands) + " bands", c, measure(c, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			waveshaper.process(context);
+		}), bytesPerSample * bands));
+	}
+	waveshaper.setBands(1);
+	results.add(makeResult("DynamicWaveshaper::process", "3 instances", c, measure(c, minSeconds, [&]() noexcept
+	{
+		for (int instance = 0; instance < DynamicWaveshaper<float>::maxBands; ++instance)
+		{
+			buffer.makeCopyOf(input, true);
+			waveshaper.process(context);
+		}
+	}), bytesPerSample * DynamicWaveshaper<float>::maxBands));
+}
+
+template <typename SampleType>
+void Benchmarks::runBBDFilter(const Case& c, double minSeconds, Array<var>& results)
+{
+	const dsp::ProcessSpec spec{ c.sampleRate, static_cast<uint32> (c.blockSize), static_cast<uint32> (c.numChannels) };
+	AudioBuffer<SampleType> buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(buffer, random);
+	dsp::AudioBlock<SampleType> block(buffer);
+	const dsp::ProcessContextReplacing<SampleType> context(block);
+
+	//filtering the block in place again each pass keeps its low end, so no denormals creep in
+	BBDFilterCoefficients coefficients;
+	coefficients.prepare(c.sampleRate);
+	coefficients.setCutoffFrequencyHz(2500.0f);
+	coefficients.setResonance(0.3f);
+	coefficients.update();
+	BBDFilter<SampleType> filter(coefficients);
+	filter.prepare(spec);
+#if JUCE_USE_SIMD
+	//interleave (read block, write scratch) + filter (read/write scratch) + deinterleave (read scratch, write block)
+	const double bytesPerSample = 6.0 * sizeof(SampleType);
+#else
+	const double bytesPerSample = 2.0 * sizeof(SampleType);
+#endif
+	results.add(makeResult("BBDFilter::process", std::is_same<SampleType, float>::value ? "float" : "double", c,
+		measure(c, minSeconds, [&]() noexcept { filter.process(context); }), bytesPerSample));
+}
+
+void Benchmarks::runFilters(const Case& c, double minSeconds, Array<var>& results)
+{
+	//in project anti-aliasing filter in both precisions (SIMD lanes halve for double)
+	runBBDFilter<float>(c, minSeconds, results);
+	runBBDFilter<double>(c, minSeconds, results);
+
+	//JUCE ladder it replaced, for comparison
+	const dsp::ProcessSpec spec{ c.sampleRate, static_cast<uint32> (c.blockSize), static_cast<uint32> (c.numChannels) };
+	AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(buffer, random);
+	dsp::AudioBlock<float> block(buffer);
+	const dsp::ProcessContextReplacing<float> context(block);
+	dsp::LadderFilter<float> ladder;
+	ladder.setMode(dsp::LadderFilter<float>::Mode::LPF24);
+	ladder.setCutoffFrequencyHz(2500.0f);
+	ladder.setResonance(0.3f);
+	ladder.prepare(spec);
+	results.add(makeResult("dsp::LadderFilter", "float", c, measure(c, minSeconds, [&]() noexcept { ladder.process(context); }), 2.0 * sizeof(float)));
+}
+
+void Benchmarks::runPrecision(const Case& c, double minSeconds, Array<var>& results)
+{
+	//the processor's buses are stereo
+	if (c.numChannels != 2)
+		return;
+
+	AudioBuffer<double> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	AudioBuffer<float> floatInput(c.numChannels, c.blockSize), floatBuffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	floatInput.makeCopyOf(input);
+	MidiBuffer midi;
+
+	//every pass restores the input first, since the output feeds the next pass otherwise (buffer traffic only: restore + process in place)
+	auto makeProcessor = [&c](AudioProcessor::ProcessingPrecision precision)
+	{
+		auto processor = std::make_unique<DlayAudioProcessor>();
+		processor->setProcessingPrecision(precision);
+		processor->setRateAndBufferSize(c.sampleRate, c.blockSize);
+		processor->prepareToPlay(c.sampleRate, c.blockSize);
+		return processor;
+	};
+
+	//float host
+	auto floatProcessor = makeProcessor(AudioProcessor::singlePrecision);
+	results.add(makeResult("DlayAudioProcessor::processBlock", "float", c, measure(c, minSeconds, [&]() noexcept
+	{
+		floatBuffer.makeCopyOf(floatInput, true);
+		floatProcessor->processBlock(floatBuffer, midi);
+	}), 4.0 * sizeof(float)));
+
+	//double host with the double path
+	auto doubleProcessor = makeProcessor(AudioProcessor::doublePrecision);
+	results.add(makeResult("DlayAudioProcessor::processBlock", "double", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		doubleProcessor->processBlock(buffer, midi);
+	}), 4.0 * sizeof(double)));
+
+	//double host converting to and from the float path, as hosts do for processors without double support
+	results.add(makeResult("DlayAudioProcessor::processBlock", "doubleViaFloat", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		floatBuffer.makeCopyOf(buffer, true);
+		floatProcessor->processBlock(floatBuffer, midi);
+		buffer.makeCopyOf(floatBuffer, true);
+	}), 4.0 * sizeof(double) + 4.0 * sizeof(float)));
+}
+
+void Benchmarks::runEngines(const Case& c, double minSeconds, Array<var>& results)
+{
+	//the processor's buses and the core instantiation are stereo
+	if (c.numChannels != 2)
+		return;
+
+	AudioBuffer<float> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	MidiBuffer midi;
+
+	//stage by stage processBlock against the single pass core (every stage enabled)
+	DlayAudioProcessor processor;
+	processor.setRateAndBufferSize(c.sampleRate, c.blockSize);
+	processor.prepareToPlay(c.sampleRate, c.blockSize);
+	OfflineRender::setParameter(processor, "compander", 1.0f);
+	processor.applyParameterState();
+	//bytes per sample count the audio buffer only; processBlock also sweeps its write block, side chain, interleaving scratch, and wet
+	//scratch once per stage, which is what the core saves at large block sizes where those sweeps no longer fit in cache
+	results.add(makeResult("DlayAudioProcessor::processBlock", "modular", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		processor.processBlock(buffer, midi);
+	}), 4.0 * sizeof(float)));
+
+	//the core, as a host without JUCE embeds it (one sample of every stage at a time, or every stage over cache resident tiles)
+	dlay::BBDChain<float, 2> core;
+	HeapBlock<float> memory(static_cast<size_t> (2 * core.getDelayLength(c.sampleRate)));
+	core.prepare(c.sampleRate, memory.getData());
+	dlay::Parameters parameters;
+	parameters.compander = true;
+	core.setParameters(parameters);
+	results.add(makeResult("dlay::BBDChain::process", "float", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		core.process(buffer.getArrayOfWritePointers(), c.blockSize);
+	}), 4.0 * sizeof(float)));
+	results.add(makeResult("dlay::BBDChain::processTiled", "float", c, measure(c, minSeconds, [&]() noexcept
+	{
+		buffer.makeCopyOf(input, true);
+		core.processTiled(buffer.getArrayOfWritePointers(), c.blockSize);
+	}), 4.0 * sizeof(float)));
+}
+
+void Benchmarks::runVoiceBank(const Case& c, double minSeconds, Array<var>& results)
+{
+	//voice counts are swept here rather than over the channel grid, once per block size and sample rate
+	if (c.numChannels != 1)
+		return;
+
+	enum { maxVoices = 64 };
+	AudioBuffer<float> input(maxVoices, c.blockSize), buffer(maxVoices, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+
+	//every stage enabled, so the bank (which neutralises rather than skips disabled stages) and the chains do the same work
+	dlay::Parameters parameters;
+	parameters.compander = true;
+
+	//one bank of every voice against one mono chain per voice, as separate instances would run
+	auto bank = std::make_unique<dlay::VoiceBank<float, maxVoices>>();
+	const int delayLength = bank->getDelayLength(c.sampleRate);
+	HeapBlock<float> bankMemory(static_cast<size_t> (maxVoices * delayLength)), chainMemory(static_cast<size_t> (maxVoices * delayLength));
+	bank->prepare(c.sampleRate, bankMemory.getData());
+	std::vector<dlay::BBDChain<float, 1>> chains(maxVoices);
+	for (int voice = 0; voice < maxVoices; ++voice)
+	{
+		parameters.seed = 0x0d1a7u + static_cast<std::uint32_t> (voice);
+		bank->setVoiceParameters(voice, parameters);
+		chains[voice].prepare(c.sampleRate, chainMemory.getData() + voice * delayLength);
+		chains[voice].setParameters(parameters);
+	}
+
+	//ns per voice sample, so a bank that scales with voice count shows as a falling line
+	for (int numVoices : { 1, 2, 4, 8, 16, 32, 64 })
+	{
+		const Case voices{ c.blockSize, numVoices, c.sampleRate };
+		results.add(makeResult("dlay::VoiceBank::process", "bank", voices, measure(voices, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			bank->process(buffer.getArrayOfWritePointers(), numVoices, c.blockSize);
+		}), 4.0 * sizeof(float)));
+		results.add(makeResult("dlay::VoiceBank::process", "chains", voices, measure(voices, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			for (int voice = 0; voice < numVoices; ++voice)
+			{
+				float* channel[] = { buffer.getWritePointer(voice) };
+				chains[voice].process(channel, c.blockSize);
+			}
+		}), 4.0 * sizeof(float)));
+	}
+}
+
+void Benchmarks::runAutomation(const Case& c, double minSeconds, Array<var>& results)
+{
+	//the processor's buses are stereo
+	if (c.numChannels != 2)
+		return;
+
+	AudioBuffer<float> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	MidiBuffer midi;
+
+	DlayAudioProcessor processor;
+	processor.setRateAndBufferSize(c.sampleRate, c.blockSize);
+	processor.prepareToPlay(c.sampleRate, c.blockSize);
+	OfflineRender::setParameter(processor, "compander", 1.0f);
+	processor.applyParameterState();
+
+	//a cutoff sweep with an event every interval samples against none (interval 0), so the cost of a split shows per interval
+	for (int interval : { 0, 256, 64, 16 })
+	{
+		if (interval > c.blockSize)
+			continue;
+		results.add(makeResult("DlayAudioProcessor::processBlock", interval == 0 ? String("static") : "event every " + String(interval), c,
+			measure(c, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			for (int sampleOffset = 0; interval > 0 && sampleOffset < c.blockSize; sampleOffset += interval)
+				processor.addParameterEvent(sampleOffset, DlayAudioProcessor::Parameter::cutoff, sampleOffset % (2 * interval) == 0 ? 1500.0f : 2500.0f);
+			processor.processBlock(buffer, midi);
+		}), 4.0 * sizeof(float)));
+	}
+}
+
+void Benchmarks::runCrossfade(const Case& c, double minSeconds, Array<var>& results)
+{
+	//the processor's buses are stereo
+	if (c.numChannels != 2)
+		return;
+
+	AudioBuffer<float> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	MidiBuffer midi;
+
+	DlayAudioProcessor processor;
+	processor.setRateAndBufferSize(c.sampleRate, c.blockSize);
+	processor.prepareToPlay(c.sampleRate, c.blockSize);
+	processor.applyParameterState();
+
+	//steady state against a Rate and Target Waveshaper switch published every block (each transition ends before the next starts, so
+	//nearly every block fades); "instant" switches with the crossfade off
+	const std::pair<float, const char*> variants[] = { { -1.0f, "steady" }, { 20.0f, "switching" }, { 0.0f, "instant" } };
+	for (const auto& variant : variants)
+	{
+		processor.setCrossfade(jmax(0.0f, variant.first));
+		int block = 0;
+		results.add(makeResult("DlayAudioProcessor::processBlock crossfade", variant.second, c, measure(c, minSeconds, [&]() noexcept
+		{
+			if (variant.first >= 0.0f)
+			{
+				processor.setRate((++block & 1) != 0 ? 150.0f : 300.0f);
+				processor.setTargetWaveshaper(block & 3);
+			}
+			buffer.makeCopyOf(input, true);
+			processor.processBlock(buffer, midi);
+		}), 4.0 * sizeof(float)));
+	}
+}
+
+void Benchmarks::runAntialiasing(const Case& c, double minSeconds, Array<var>& results)
+{
+#if JUCE_USE_SIMD
+	if (c.numChannels > static_cast<int> (dsp::SIMDRegister<float>::size()))
+		return;
+#endif
+	AudioBuffer<float> input(c.numChannels, c.blockSize), buffer(c.numChannels, c.blockSize);
+	Random random(0x0d1a7);
+	fillNoise(input, random);
+	dsp::AudioBlock<float> block(buffer);
+
+	//the Smashed shaper fully on, plain and with ADAA at the base rate against plain at 2x and 4x through JUCE's polyphase IIR half band
+	//oversampling; bytes as runWaveshapers, plus the double history for ADAA and per oversampled sample for oversampling
+	const char* variants[] = { "plain", "adaa1", "adaa2", "oversampled2x", "oversampled4x" };
+	for (int variant = 0; variant < 5; ++variant)
+	{
+		const int factorLog2 = jmax(0, variant - 2);
+		const int factor = 1 << factorLog2;
+		DynamicWaveshaper<float> waveshaper;
+		waveshaper.prepare({ c.sampleRate * factor, static_cast<uint32> (c.blockSize * factor), static_cast<uint32> (c.numChannels) });
+		waveshaper.setThreshold(-40.0f);
+		waveshaper.setTargetWaveshaper(3);
+		waveshaper.setAntialiasing(factorLog2 == 0 ? variant : 0);
+
+		std::unique_ptr<dsp::Oversampling<float>> oversampling;
+		if (factorLog2 > 0)
+		{
+			oversampling = std::make_unique<dsp::Oversampling<float>>(static_cast<size_t> (c.numChannels), static_cast<size_t> (factorLog2),
+				dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+			oversampling->initProcessing(static_cast<size_t> (c.blockSize));
+		}
+
+		const auto processBlock = [&](dsp::AudioBlock<float>& audio) noexcept
+		{
+			if (oversampling == nullptr)
+			{
+				waveshaper.process(dsp::ProcessContextReplacing<float>(audio));
+				return;
+			}
+			auto upsampled = oversampling->processSamplesUp(audio);
+			waveshaper.process(dsp::ProcessContextReplacing<float>(upsampled));
+			oversampling->processSamplesDown(audio);
+		};
+
+		const double ns = measure(c, minSeconds, [&]() noexcept
+		{
+			buffer.makeCopyOf(input, true);
+			processBlock(block);
+		});
+		const double bytesPerSample = factorLog2 > 0 ? (12.0 * factor + 4.0) * sizeof(float) : 12.0 * sizeof(float) + (variant > 0 ? 2.0 * sizeof(double) : 0.0);
+		var result = makeResult("DynamicWaveshaper::process antialiasing", variants[variant], c, ns, bytesPerSample);
+		result.getDynamicObject()->setProperty("aliasingDb", measureAliasing(c, processBlock));
+		results.add(result);
+	}
+}
+
+void Benchmarks::runState(int numInstances, Array<var>& results)
+{
+	//a project of default instances with different settings, as a host autosave or undo snapshot would walk it
+	OwnedArray<DlayAudioProcessor> processors;
+	for (int instance = 0; instance < numInstances; ++instance)
+	{
+		auto* processor = processors.add(new DlayAudioProcessor());
+		OfflineRender::setParameter(*processor, "rate", static_cast<float> (instance % 1000));
+		OfflineRender::setParameter(*processor, "compander", static_cast<float> (instance % 2));
+	}
+	Array<MemoryBlock> states;
+	states.resize(numInstances);
+
+	const std::pair<bool, const char*> formats[] = { { true, "binary" }, { false, "xml" } };
+	for (const auto& format : formats)
+	{
+		//save all, then restore all from the saved blocks
+		int64 numBytes = 0;
+		const int64 saveStart = Time::getHighResolutionTicks();
+		for (int instance = 0; instance < numInstances; ++instance)
+		{
+			if (format.first)
+				processors[instance]->getStateInformation(states.getReference(instance));
+			else
+				processors[instance]->getXmlStateInformation(states.getReference(instance));
+			numBytes += static_cast<int64> (states.getReference(instance).getSize());
+		}
+		const int64 restoreStart = Time::getHighResolutionTicks();
+		for (int instance = 0; instance < numInstances; ++instance)
+			processors[instance]->setStateInformation(states.getReference(instance).getData(), static_cast<int> (states.getReference(instance).getSize()));
+		const int64 end = Time::getHighResolutionTicks();
+
+		const auto usPerInstance = [numInstances](int64 ticks) { return Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / numInstances; };
+		const std::pair<const char*, double> phases[] = {
+			{ "DlayAudioProcessor::getStateInformation", usPerInstance(restoreStart - saveStart) },
+			{ "DlayAudioProcessor::setStateInformation", usPerInstance(end - restoreStart) } };
+		for (const auto& phase : phases)
+		{
+			DynamicObject::Ptr result = new DynamicObject();
+			result->setProperty("component", phase.first);
+			result->setProperty("variant", format.second);
+			result->setProperty("numInstances", numInstances);
+			result->setProperty("usPerInstance", phase.second);
+			result->setProperty("bytesPerInstance", static_cast<double> (numBytes) / numInstances);
+			results.add(var(result.get()));
+		}
+	}
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayLine.h"
+#include "DynamicWaveshaper.h"
+#include "BBDFilter.h"
+#include "PluginProcessor.h"
+#include "OfflineRender.h"
+#include "DlayCore.h"
+#include "DlayVoiceBank.h"
+
+//Per component microbenchmarks over block size, channel count, and sample rate, reported as JSON
+//each result gives ns per channel sample and the approximate bytes of audio memory touched per channel sample
+class Benchmarks
+{
+public:
+
+	//parameter grid (defaults cover 16-4096 sample blocks, 1-8 channels, and 44.1kHz-192kHz)
+	struct Config
+	{
+		Array<int> blockSizes{ 16, 64, 256, 1024, 4096 };
+		Array<int> channelCounts{ 1, 2, 4, 8 };
+		Array<double> sampleRates{ 44100.0, 48000.0, 96000.0, 192000.0 };
+
+		//minimum measured time per case (after one warm up block)
+		double minSeconds = 0.05;
+
+		//instances of the project whose state is saved and restored
+		int numStateInstances = 500;
+	};
+
+	//run every component over the grid, plus state save and restore, and return a JSON array of result objects
+	static var run(const Config& config);
+
+	//run and format as a JSON document: { "simd": bool, "results": [...] }
+	static String runToJSON(const Config& config);
+
+private:
+
+	//one case of the grid
+	struct Case
+	{
+		int blockSize, numChannels;
+		double sampleRate;
+	};
+
+	//build a result object
+	static var makeResult(const String& component, const String& variant, const Case& c, double nsPerSample, double bytesPerSample);
+
+	//call processBlock until minSeconds has passed and return ns per channel sample
+	template <typename ProcessBlock>
+	static double measure(const Case& c, double minSeconds, ProcessBlock&& processBlock);
+
+	//run a bin exact sine near 5kHz at 0.9 through processBlock(dsp::AudioBlock<float>&) and return the energy off its harmonics relative to
+	//the energy on them in dB (Hann window, after a quarter second to settle)
+	template <typename ProcessBlock>
+	static double measureAliasing(const Case& c, ProcessBlock&& processBlock);
+
+	//components
+	static void runDelayLine(const Case& c, double minSeconds, Array<var>& results);
+	static void runSideChain(const Case& c, double minSeconds, Array<var>& results);
+	static void runWaveshapers(const Case& c, double minSeconds, Array<var>& results);
+	static void runFilters(const Case& c, double minSeconds, Array<var>& results);
+	static void runPrecision(const Case& c, double minSeconds, Array<var>& results);
+	static void runEngines(const Case& c, double minSeconds, Array<var>& results);
+	static void runVoiceBank(const Case& c, double minSeconds, Array<var>& results);
+	static void runAutomation(const Case& c, double minSeconds, Array<var>& results);
+	static void runCrossfade(const Case& c, double minSeconds, Array<var>& results);
+	static void runAntialiasing(const Case& c, double minSeconds, Array<var>& results);
+
+	//save and restore every instance of a numInstances project, binary against legacy XML (results give us and bytes per instance)
+	static void runState(int numInstances, Array<var>& results);
+
+	template <typename SampleType>
+	static void runBBDFilter(const Case& c, double minSeconds, Array<var>& results);
+
+	//fixed seed noise at -6dB
+	template <typename SampleType>
+	static void fillNoise(AudioBuffer<SampleType>& buffer, Random& random) noexcept;
+};
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "BinaryState.h"
+
+void BinaryState::write(const AudioProcessor& processor, MemoryBlock& destData)
+{
+	const auto& parameters = processor.getParameters();
+	const int numValues = jmin(parameters.size(), 0xffff);
+	destData.setSize(static_cast<size_t> (headerSize + numValues * 8));
+	auto* bytes = static_cast<uint8*> (destData.getData());
+
+	const uint32 header[] = { ByteOrder::swapIfBigEndian(static_cast<uint32> (magic)),
+		ByteOrder::swapIfBigEndian(static_cast<uint32> (version | (numValues << 16))) };
+	std::memcpy(bytes, header, headerSize);
+
+	//ID hashes and plain values, so a later range change does not move saved settings
+	for (int i = 0; i < numValues; ++i)
+	{
+		const auto* parameter = parameters.getUnchecked(i);
+		const auto* ranged = dynamic_cast<const RangedAudioParameter*> (parameter);
+		const float value = ranged != nullptr ? ranged->convertFrom0to1(parameter->getValue()) : parameter->getValue();
+		uint32 entry[2];
+		entry[0] = ByteOrder::swapIfBigEndian(getIDHash(*parameter));
+		std::memcpy(&entry[1], &value, 4);
+		entry[1] = ByteOrder::swapIfBigEndian(entry[1]);
+		std::memcpy(bytes + headerSize + i * 8, entry, 8);
+	}
+}
+
+bool BinaryState::read(AudioProcessor& processor, const void* data, int sizeInBytes)
+{
+	if (data == nullptr || sizeInBytes < headerSize)
+		return false;
+	const auto* bytes = static_cast<const uint8*> (data);
+	const uint32 versionAndCount = ByteOrder::littleEndianInt(bytes + 4);
+	const int stateVersion = static_cast<int> (versionAndCount & 0xffff);
+	if (ByteOrder::littleEndianInt(bytes) != magic || stateVersion < 1 || stateVersion > version)
+		return false;
+	const int numValues = static_cast<int> (versionAndCount >> 16);
+	const int entrySize = stateVersion == 1 ? 4 : 8;
+	if (sizeInBytes < headerSize + numValues * entrySize)
+		return false;
+
+	const auto& parameters = processor.getParameters();
+	if (stateVersion == 1)
+	{
+		//no IDs: values in the getParameters() order of the layout that saved them
+		for (int i = 0; i < jmin(numValues, parameters.size()); ++i)
+		{
+			const uint32 bits = ByteOrder::littleEndianInt(bytes + headerSize + i * 4);
+			float value;
+			std::memcpy(&value, &bits, 4);
+			setPlainValue(*parameters.getUnchecked(i), value);
+		}
+		return true;
+	}
+
+	for (int i = 0; i < numValues; ++i)
+	{
+		const uint32 hash = ByteOrder::littleEndianInt(bytes + headerSize + i * 8);
+		const uint32 bits = ByteOrder::littleEndianInt(bytes + headerSize + i * 8 + 4);
+		float value;
+		std::memcpy(&value, &bits, 4);
+
+		//the parameter at the same index first (an unchanged layout), then every parameter
+		AudioProcessorParameter* match = nullptr;
+		if (i < parameters.size() && getIDHash(*parameters.getUnchecked(i)) == hash)
+			match = parameters.getUnchecked(i);
+		for (int j = 0; match == nullptr && j < parameters.size(); ++j)
+			if (getIDHash(*parameters.getUnchecked(j)) == hash)
+				match = parameters.getUnchecked(j);
+		if (match != nullptr)
+			setPlainValue(*match, value);
+	}
+	return true;
+}
+
+uint32 BinaryState::getIDHash(const AudioProcessorParameter& parameter)
+{
+	const auto* withID = dynamic_cast<const AudioProcessorParameterWithID*> (&parameter);
+	const String id = withID != nullptr ? withID->paramID : parameter.getName(1024);
+	uint32 hash = 0x811c9dc5u;
+	for (auto* c = id.toRawUTF8(); *c != 0; ++c)
+		hash = (hash ^ static_cast<uint8> (*c)) * 0x01000193u;
+	return hash;
+}
+
+void BinaryState::setPlainValue(AudioProcessorParameter& parameter, float value)
+{
+	if (!std::isfinite(value))
+		return;
+	const auto* ranged = dynamic_cast<const RangedAudioParameter*> (&parameter);
+	parameter.setValueNotifyingHost(ranged != nullptr ? ranged->convertTo0to1(value) : jlimit(0.0f, 1.0f, value));
+}
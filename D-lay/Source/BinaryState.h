@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Compact plugin state: every parameter's plain value tagged with a hash of its ID behind an 8 byte header, instead of the value tree's XML
+//layout (little endian): uint32 magic, uint16 version, uint16 number of values, then per value a uint32 ID hash and a float32
+//(version 1 states hold the float32 values alone in getParameters() order and are still read)
+//saving is one allocation of the host's block at most and restoring allocates nothing, so hosts can snapshot many instances cheaply
+class BinaryState
+{
+public:
+
+	enum : uint32 { magic = 0x42594c44 }; //"DLYB"
+	enum { version = 2, headerSize = 8 };
+
+	// Essential Methods
+	//==============================================================================
+
+	//replace destData with the state of processor's parameters
+	static void write(const AudioProcessor& processor, MemoryBlock& destData);
+
+	//set processor's parameters from a state written by write, matching values to parameters by ID, so parameters added, removed, or
+	//reordered since the state was saved keep their values; parameters the state lacks are left unchanged, values of unknown IDs and
+	//non-finite values are ignored; returns false, changing nothing, if data is not a binary state of a known version
+	static bool read(AudioProcessor& processor, const void* data, int sizeInBytes);
+
+	//32 bit FNV-1a hash of parameter's ID (of its name for parameters without one) as stored with its value
+	static uint32 getIDHash(const AudioProcessorParameter& parameter);
+
+private:
+
+	//set parameter from a saved plain value
+	static void setPlainValue(AudioProcessorParameter& parameter, float value);
+};
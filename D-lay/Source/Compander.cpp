@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "Compander.h"
+
+template <typename SampleType>
+void Compander<SampleType>::prepare(const dsp::ProcessSpec spec)
+{
+	//save spec
+	mSampleRate = spec.sampleRate;
+	mBlockSize = static_cast<int> (spec.maximumBlockSize);
+	mNumChannels = static_cast<int> (spec.numChannels);
+
+#if JUCE_USE_SIMD
+	mInterleaver.prepare(mNumChannels, mBlockSize);
+	mState = dsp::AudioBlock<dsp::SIMDRegister<SampleType>>(stateData, 1, static_cast<size_t> (mInterleaver.getNumGroups() * stateSize));
+#else
+	mState.allocate(static_cast<size_t> (mNumChannels * stateSize), true);
+#endif
+
+	//the detector coefficient depends on the sample rate
+	mBufVersion = -1;
+	reset();
+}
+
+template <typename SampleType>
+void Compander<SampleType>::reset() noexcept
+{
+#if JUCE_USE_SIMD
+	for (int group = 0; group < mInterleaver.getNumGroups(); ++group)
+	{
+		mState.getChannelPointer(0)[group * stateSize] = static_cast<SampleType> (0);
+		mState.getChannelPointer(0)[group * stateSize + 1] = static_cast<SampleType> (1);
+	}
+#else
+	for (int channel = 0; channel < mNumChannels; ++channel)
+	{
+		mState[channel * stateSize] = 0;
+		mState[channel * stateSize + 1] = 1;
+	}
+#endif
+}
+
+template <typename SampleType>
+void Compander<SampleType>::setTimeConstant(float msTimeConstant) noexcept
+{
+	jassert(msTimeConstant > 0.0f);
+	mParameters.publish([msTimeConstant](Parameters& parameters) { parameters.msTimeConstant = msTimeConstant; });
+}
+
+template <typename SampleType>
+void Compander<SampleType>::setReferenceLevel(float dbReference) noexcept
+{
+	jassert(dbReference <= 0.0f);
+	mParameters.publish([dbReference](Parameters& parameters) { parameters.dbReference = dbReference; });
+}
+
+template class Compander<float>;
+template class Compander<double>;
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SIMDInterleaver.h"
+#include "ParameterSnapshot.h"
+
+//One half of an NE570 style compander: a 2:1 compressor before the delay memory or a 1:2 expander after it
+//mean square detectors run across channels in SIMD lanes and gain cell levels are updated at a control rate with linear ramps; the expander
+//multiplies by the level of its input, the compressor divides by the level of its output, so a signal through both is restored
+template <typename SampleType>
+class Compander
+{
+public:
+
+	enum class Mode
+	{
+		compress,
+		expand
+	};
+
+	explicit Compander(Mode mode) noexcept : mCompress(mode == Mode::compress) {}
+
+	// Essential Methods
+	//==============================================================================
+
+	//save environment variables, allocate interleaving memory, and clear detectors
+	void prepare(const dsp::ProcessSpec spec);
+
+	//clear detectors and levels
+	void reset() noexcept;
+
+	//compress or expand context in place
+	template <typename ProcessContext>
+	void process(const ProcessContext& context) noexcept
+	{
+		auto& block = context.getOutputBlock();
+		jassert(!context.usesSeparateInputAndOutputBlocks());
+		if (context.isBypassed)
+			return;
+		updateBufParams();
+
+		const int numSamples = static_cast<int> (block.getNumSamples());
+		const int numChannels = static_cast<int> (block.getNumChannels());
+#if JUCE_USE_SIMD
+		for (int group = 0; group * SIMDInterleaver<SampleType>::lanes < numChannels; ++group)
+		{
+			auto* interleaved = mInterleaver.interleave(group, block);
+			auto* state = mState.getChannelPointer(0) + group * stateSize;
+			processLanes(interleaved, numSamples, state[0], state[1]);
+			mInterleaver.deinterleave(group, block);
+		}
+#else
+		for (int channel = 0; channel < numChannels; ++channel)
+			processLanes(block.getChannelPointer(channel), numSamples, mState[channel * stateSize], mState[channel * stateSize + 1]);
+#endif
+	}
+
+	// Parameters
+	//==============================================================================
+
+	//set detector time constant using ms value > 0.0f
+	void setTimeConstant(float msTimeConstant) noexcept;
+
+	//set unity gain level using decibel value <= 0.0f
+	void setReferenceLevel(float dbReference) noexcept;
+
+private:
+
+	//mean square and current level per channel (or per SIMD channel group); levels are recomputed every controlInterval samples
+	enum { stateSize = 2, controlInterval = 16 };
+
+	//detect and apply the level to data in place (Vec is SampleType or SIMDRegister<SampleType>)
+	template <typename Vec>
+	void processLanes(Vec* data, int numSamples, Vec& meanSquare, Vec& level) const noexcept
+	{
+		const Vec coeff = mBufCoeff, oneMinusCoeff = static_cast<SampleType> (1) - mBufCoeff;
+		for (int start = 0; start < numSamples; start += controlInterval)
+		{
+			//ramp from the current level to the level of the detector
+			const int length = jmin(static_cast<int> (controlInterval), numSamples - start);
+			const Vec step = (computeLevel(meanSquare) - level) * Vec(static_cast<SampleType> (1) / static_cast<SampleType> (length));
+			for (int i = start; i < start + length; ++i)
+			{
+				const Vec x = data[i];
+				if (mCompress)
+				{
+					//2:1 as the level of the output follows the square root of the input
+					level = level + step;
+					const Vec y = divide(x, level);
+					meanSquare = coeff * meanSquare + oneMinusCoeff * y * y;
+					data[i] = y;
+				}
+				else
+				{
+					meanSquare = coeff * meanSquare + oneMinusCoeff * x * x;
+					level = level + step;
+					data[i] = x * level;
+				}
+			}
+		}
+	}
+
+	//gain cell level for a detector mean square: (meanSquare / reference^2)^(1/2)
+	SampleType computeLevel(SampleType meanSquare) const noexcept
+	{
+		return std::sqrt(jmax(meanSquare, static_cast<SampleType> (floorMeanSquare)) * mBufInverseReferenceSquared);
+	}
+	static SampleType divide(SampleType x, SampleType level) noexcept { return x / level; }
+#if JUCE_USE_SIMD
+	dsp::SIMDRegister<SampleType> computeLevel(dsp::SIMDRegister<SampleType> meanSquare) const noexcept
+	{
+		dsp::SIMDRegister<SampleType> level;
+		for (size_t lane = 0; lane < dsp::SIMDRegister<SampleType>::size(); ++lane)
+			level.set(lane, computeLevel(meanSquare.get(lane)));
+		return level;
+	}
+
+	//SIMDRegister has no division
+	static dsp::SIMDRegister<SampleType> divide(dsp::SIMDRegister<SampleType> x, dsp::SIMDRegister<SampleType> level) noexcept
+	{
+		for (size_t lane = 0; lane < dsp::SIMDRegister<SampleType>::size(); ++lane)
+			x.set(lane, x.get(lane) / level.get(lane));
+		return x;
+	}
+#endif
+
+	//called once per process: one snapshot acquire, coefficients recomputed only when a new version was published
+	void updateBufParams() noexcept
+	{
+		const auto& parameters = mParameters.acquire();
+		if (mParameters.getVersion() == mBufVersion)
+			return;
+		mBufVersion = mParameters.getVersion();
+		mBufCoeff = static_cast<SampleType> (static_cast<float> (exp(-1000.0 / (parameters.msTimeConstant * mSampleRate))));
+		const float reference = Decibels::decibelsToGain(parameters.dbReference);
+		mBufInverseReferenceSquared = static_cast<SampleType> (1.0f / (reference * reference));
+	}
+
+	//detector floor (-60dB RMS) bounds the gain on silence to +-40dB, so compressing a sanitised block stays finite and below 400 (the
+	//compressed block is written to the delay memory unclamped, see DlayAudioProcessor::processModular)
+	static constexpr float floorMeanSquare = 1.0e-6f;
+
+	//set by Mode
+	const bool mCompress;
+
+	//detector and level state
+#if JUCE_USE_SIMD
+	dsp::AudioBlock<dsp::SIMDRegister<SampleType>> mState;
+	HeapBlock<char> stateData;
+	SIMDInterleaver<SampleType> mInterleaver;
+#else
+	HeapBlock<SampleType> mState;
+#endif
+
+	//parameters derived from the snapshot version mBufVersion (-1 forces an update, e.g. after a sample rate change)
+	SampleType mBufCoeff = static_cast<SampleType> (0.9977), mBufInverseReferenceSquared = 100;
+	int mBufVersion = -1;
+
+	//processing parameters published as one coherent set (units: ms, dB; NE570 typical: 10ms detector, unity gain at -20dBFS)
+	struct Parameters
+	{
+		float msTimeConstant = 10.0f, dbReference = -20.0f;
+	};
+	ParameterSnapshot<Parameters> mParameters;
+
+	//environment variables
+	double mSampleRate = 44100.0;
+	int mBlockSize = 0, mNumChannels = 0;
+};
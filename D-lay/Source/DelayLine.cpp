@@ -10,32 +10,59 @@
 
 #include "DelayLine.h"
 
-void DelayLine::prepare(const dsp::ProcessSpec spec) 
+template <typename SampleType>
+void DelayLine<SampleType>::prepare(const dsp::ProcessSpec spec) 
 {
 	//save spec
 	mBlockSize = spec.maximumBlockSize;
 	mNumChannels = spec.numChannels;
 	mSampleRate = spec.sampleRate;
-	//initialize 1 second mDelayBuffer with some extra overhead for safety
-	mDelayBufferLength = (mSampleRate + mBlockSize) - (mSampleRate % mBlockSize); //make sure mDelayBuffer is aligned to mBlockSize
-	mDelayBuffer.setSize(mNumChannels, mDelayBufferLength);
-	mDelayBufferBlock = dsp::AudioBlock<float>(mDelayBuffer);
+	//initialize 1 second mDelayBuffer plus a block (so a block read a full second behind never reaches the block being written), followed by
+	//a block of overhang for write blocks that wrap around
+	mDelayBufferLength = mSampleRate + mBlockSize;
+	mDelayBuffer.setSize(mNumChannels, mDelayBufferLength + mBlockSize);
+	mDelayBuffer.clear(); //start from silence so renders are repeatable
+	mWritePosition = mOverhang = 0;
+	mNumSamples = mBlockSize;
+	mDelayBufferBlock = dsp::AudioBlock<SampleType>(mDelayBuffer);
+	mReadPointers.calloc(static_cast<size_t> (mNumChannels));
+	mBufVersion = -1; //Rate in samples depends on the sample rate
+
+	//transition scratch (a new sample rate never fades from the old one)
+	mFadeBuffer.setSize(mNumChannels, mBlockSize);
+	mFadeIn.calloc(static_cast<size_t> (mBlockSize));
+	mFadeOut.calloc(static_cast<size_t> (mBlockSize));
+	mFadeFeedback.calloc(static_cast<size_t> (mBlockSize));
+	mFadePosition = mFadeLength = 0;
 }
 
-void DelayLine::setRate(float msRate) noexcept
+template <typename SampleType>
+void DelayLine<SampleType>::setRate(float msRate) noexcept
 {
 	jassert(msRate >= 0.0f && msRate <= 1000.0f);
-	mRate = (msRate / 1000.0f) * static_cast<float>(mSampleRate);
+	mParameters.publish([msRate](Parameters& parameters) { parameters.msRate = msRate; });
 }
 
-void DelayLine::setFeedback(float dbFeedback) noexcept
+template <typename SampleType>
+void DelayLine<SampleType>::setFeedback(float dbFeedback) noexcept
 {
 	jassert(dbFeedback <= 0.0f);
-	mFeedback = Decibels::decibelsToGain(dbFeedback);
+	mParameters.publish([dbFeedback](Parameters& parameters) { parameters.feedback = Decibels::decibelsToGain(dbFeedback); });
 }
 
-void DelayLine::setWet(int percentWet) noexcept
+template <typename SampleType>
+void DelayLine<SampleType>::setWet(int percentWet) noexcept
 {
 	jassert(percentWet >= 0 && percentWet <= 100);
-	mWet = static_cast<float> (percentWet) / 100.0f;
+	mParameters.publish([percentWet](Parameters& parameters) { parameters.wet = static_cast<float> (percentWet) / 100.0f; });
 }
+
+template <typename SampleType>
+void DelayLine<SampleType>::setCrossfade(float msCrossfade) noexcept
+{
+	jassert(msCrossfade >= 0.0f);
+	mParameters.publish([msCrossfade](Parameters& parameters) { parameters.msCrossfade = msCrossfade; });
+}
+
+template class DelayLine<float>;
+template class DelayLine<double>;
@@ -10,9 +10,12 @@
 
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "Sanitiser.h"
+#include "ParameterSnapshot.h"
 
 //Approximately one second delay line with ability to write, read, and modify written memory
+template <typename SampleType>
 class DelayLine 
 {
 public:
@@ -23,50 +26,78 @@ public:
 	//save environment variables and setup delay line 
 	void prepare(const dsp::ProcessSpec spec);
 
-	//copy buffer to mWriteBlock's data in delay line 
-	void fillDelayBuffer(AudioBuffer<float>& buffer) noexcept
+	//copy buffer (any length up to the prepared block size) to mWriteBlock's data in delay line 
+	void fillDelayBuffer(AudioBuffer<SampleType>& buffer) noexcept
 	{
-		//use smart pointer to automatically manage garbage for every new assignment 
-		//use 'make_unique_default_init' intsead of 'reset' once c++20 fully releases for an exception safe method with guaranteed default value initialization (no expensive zeroing of memory)
-		mWriteBlock.reset(new dsp::AudioBlock<float>(mDelayBufferBlock.getSubBlock(mWritePosition, mBlockSize))); 
-		mWriteBlock->copyFrom(buffer, 0, 0, mBlockSize);
+		//the last write block's overhang is final now (stages may process it after getFromDelayBuffer), so wrap it to the start
+		for (int channel = 0; channel < mNumChannels && mOverhang > 0; ++channel)
+			mDelayBuffer.copyFrom(channel, 0, mDelayBuffer, channel, mDelayBufferLength, mOverhang);
+		mOverhang = 0;
+
+		//the write block is contiguous, running past mDelayBufferLength into the overhang when it wraps (mWriteBlock itself is allocated once)
+		mNumSamples = buffer.getNumSamples();
+		jassert(mNumSamples <= mBlockSize);
+		*mWriteBlock = mDelayBufferBlock.getSubBlock(static_cast<size_t> (mWritePosition), static_cast<size_t> (mNumSamples));
+		mWriteBlock->copyFrom(buffer, 0, 0, mNumSamples);
 	}
 
 	//add delayed signal to buffer and mWriteBlock's data in delay line
-	void getFromDelayBuffer(AudioBuffer<float>& buffer) noexcept
+	void getFromDelayBuffer(AudioBuffer<SampleType>& buffer) noexcept
+	{
+		getFromDelayBuffer(buffer, [&buffer](const SampleType* const* source, int numChannels, int startSample, int numSamples, SampleType wet) noexcept
+		{
+			for (int channel = 0; channel < numChannels; ++channel)
+				buffer.addFrom(channel, startSample, source[channel], numSamples, wet);
+			return source;
+		});
+	}
+
+	//pass the delayed signal to addWet(source, numChannels, startSample, numSamples, wet) for the wet mix, then add the signal it returns to
+	//mWriteBlock's data in delay line as feedback; addWet is called once per contiguous read segment (twice when the read wraps around), must
+	//add wet * source into buffer at startSample, and returns the numSamples long channels to recirculate (source itself, or a wet path stage's
+	//copy of it so the loop closes after that stage)
+	template <typename WetPath>
+	void getFromDelayBuffer(AudioBuffer<SampleType>& buffer, WetPath&& addWet) noexcept
 	{
+		ignoreUnused(buffer);
 		updateBufParams();
 
 		//set mReadPosition
-		mReadPosition = (mDelayBufferLength + mWritePosition - mBufRate) % mDelayBufferLength;
-		
-		//normal get case
-		if (mDelayBufferLength > mBlockSize + mReadPosition)
+		mReadPosition = getReadIndex(mBufRate, 0);
+
+		if (mFadePosition < mFadeLength)
 		{
-			for (int channel = 0; channel < mNumChannels; ++channel) {
-				//get read data
-				const float* delayBufferReadPos = mDelayBuffer.getReadPointer(channel, mReadPosition);
-				mDelayBuffer.addFrom(channel, mWritePosition, delayBufferReadPos, mBlockSize, mBufFeedback);
-				buffer.addFrom(channel, 0, delayBufferReadPos, mBlockSize, mBufWet);
-			}
+			crossfadeFromDelayBuffer(addWet);
 		}
-		//circular buffer wrap-around
-		else 
+		else
 		{
-			for (int channel = 0; channel < mNumChannels; ++channel) {
-				//get read data and remaining samples in mDelayBuffer
-				const float* delayBufferReadPos = mDelayBuffer.getReadPointer(channel, mReadPosition);
-				const int bufferRemaining = mDelayBufferLength - mReadPosition;
-				mDelayBuffer.addFrom(channel, mWritePosition, delayBufferReadPos, bufferRemaining, mBufFeedback);
-				buffer.addFrom(channel, 0, delayBufferReadPos, bufferRemaining, mBufWet);
-				mDelayBuffer.addFrom(channel, mWritePosition + bufferRemaining, delayBufferReadPos - mReadPosition, mBlockSize - bufferRemaining, mBufFeedback);
-				buffer.addFrom(channel, bufferRemaining, delayBufferReadPos - mReadPosition, mBlockSize - bufferRemaining, mBufWet);
+			//normal get case: one segment (a read from behind the write block runs on into the overhang with it); circular buffer
+			//wrap-around: remaining samples in mDelayBuffer, then from its start
+			const int firstLength = mReadPosition <= mWritePosition ? mNumSamples : jmin(mNumSamples, mDelayBufferLength - mReadPosition);
+			const int secondLength = mNumSamples - firstLength;
+
+			//wet mix and feedback of each segment
+			for (int channel = 0; channel < mNumChannels; ++channel)
+				mReadPointers[channel] = mDelayBuffer.getReadPointer(channel, mReadPosition);
+			addFeedback(addWet(mReadPointers.getData(), mNumChannels, 0, firstLength, mBufWet), 0, firstLength);
+			if (secondLength > 0)
+			{
+				for (int channel = 0; channel < mNumChannels; ++channel)
+					mReadPointers[channel] = mDelayBuffer.getReadPointer(channel);
+				addFeedback(addWet(mReadPointers.getData(), mNumChannels, firstLength, secondLength, mBufWet), firstLength, secondLength);
 			}
 		}
-		//update mWritePosition
-		mWritePosition += mBlockSize;
-		if (mWritePosition == mDelayBufferLength)
-			mWritePosition = 0;
+
+		//keep the feedback recursion finite and bounded before the written block is read again
+		mFeedbackSanitiser.process(*mWriteBlock);
+
+		//update mWritePosition (the next fillDelayBuffer wraps the overhang)
+		mWritePosition += mNumSamples;
+		if (mWritePosition >= mDelayBufferLength)
+		{
+			mOverhang = mWritePosition - mDelayBufferLength;
+			mWritePosition = mOverhang;
+		}
 	}
 	
 	// Parameters, mWriteBlock, and Extras
@@ -80,33 +111,139 @@ public:
 
 	//set Wet using percent value between 0 and 100
 	void setWet(int percentWet) noexcept;
+
+	//set the transition time of Rate, Feedback, and Wet changes using ms value >= 0.0f (0 switches instantly)
+	void setCrossfade(float msCrossfade) noexcept;
 	
 	//process after call to fillDelayLine and before call to getFromDelayLine to simulate delay line insertion effects
-	std::unique_ptr<dsp::AudioBlock<float>> mWriteBlock;
+	std::unique_ptr<dsp::AudioBlock<SampleType>> mWriteBlock = std::make_unique<dsp::AudioBlock<SampleType>>();
+
+	//health counters of the feedback path
+	const Sanitiser& getFeedbackSanitiser() const noexcept { return mFeedbackSanitiser; }
 
 private:
 	
-	//delay buffer variables
-	int mWritePosition = 0, mReadPosition, mDelayBufferLength;
-	dsp::AudioBlock<float> mDelayBufferBlock;
-	AudioBuffer<float> mDelayBuffer;
+	//delay buffer variables: mDelayBufferLength samples of circular buffer, then mBlockSize samples of overhang that a write block wrapping
+	//around runs into (mOverhang samples of it to wrap to the start), and the samples of the current block
+	int mWritePosition = 0, mReadPosition = 0, mDelayBufferLength = 0, mOverhang = 0, mNumSamples = 0;
+	dsp::AudioBlock<SampleType> mDelayBufferBlock;
+	AudioBuffer<SampleType> mDelayBuffer;
+	HeapBlock<const SampleType*> mReadPointers;
+
+	//guards mDelayBuffer against NaNs, denormals, and runaway feedback
+	Sanitiser mFeedbackSanitiser;
+
+	//delay buffer index of sample i of a read delay samples behind the write block
+	int getReadIndex(int delay, int i) const noexcept
+	{
+		const int index = mWritePosition + i - delay;
+		return index < 0 ? index + mDelayBufferLength : index;
+	}
+
+	//add Feedback times the recirculated segment loop (numSamples long) into the written block from startSample
+	void addFeedback(const SampleType* const* loop, int startSample, int numSamples) noexcept
+	{
+		for (int channel = 0; channel < mNumChannels; ++channel)
+			mDelayBuffer.addFrom(channel, mWritePosition + startSample, loop[channel], numSamples, mBufFeedback);
+	}
+
+	//transition block: read the old and new Rate side by side with an equal-power fade (the two reads are different parts of the signal),
+	//and ramp Feedback (per sample) and Wet (per fadeStep samples, as addWet takes one gain) from their old values
+	template <typename WetPath>
+	void crossfadeFromDelayBuffer(WetPath& addWet) noexcept
+	{
+		const bool moved = mFadeFrom.rate != mBufRate;
+		for (int i = 0; i < mNumSamples; ++i)
+		{
+			const SampleType progress = jmin(static_cast<SampleType> (1), static_cast<SampleType> (mFadePosition + i) / static_cast<SampleType> (mFadeLength));
+			mFadeIn[i] = std::sin(progress * MathConstants<SampleType>::halfPi);
+			mFadeOut[i] = std::cos(progress * MathConstants<SampleType>::halfPi);
+			mFadeFeedback[i] = mFadeFrom.feedback + progress * (mBufFeedback - mFadeFrom.feedback);
+		}
+
+		//faded read (all of it before any feedback is written, as in the steady state)
+		for (int channel = 0; channel < mNumChannels; ++channel)
+		{
+			const SampleType* delay = mDelayBuffer.getReadPointer(channel);
+			SampleType* faded = mFadeBuffer.getWritePointer(channel);
+			for (int i = 0; i < mNumSamples; ++i)
+			{
+				SampleType read = delay[getReadIndex(mBufRate, i)];
+				if (moved)
+					read = mFadeIn[i] * read + mFadeOut[i] * delay[getReadIndex(mFadeFrom.rate, i)];
+				faded[i] = read;
+			}
+		}
+
+		//wet mix of the faded read, then ramped feedback of what the wet path recirculates
+		for (int start = 0; start < mNumSamples; start += fadeStep)
+		{
+			const int numSamples = jmin(static_cast<int> (fadeStep), mNumSamples - start);
+			const SampleType progress = jmin(static_cast<SampleType> (1), static_cast<SampleType> (mFadePosition + start + numSamples / 2) / static_cast<SampleType> (mFadeLength));
+			for (int channel = 0; channel < mNumChannels; ++channel)
+				mReadPointers[channel] = mFadeBuffer.getReadPointer(channel, start);
+			const SampleType* const* loop = addWet(mReadPointers.getData(), mNumChannels, start, numSamples, mFadeFrom.wet + progress * (mBufWet - mFadeFrom.wet));
+			for (int channel = 0; channel < mNumChannels; ++channel)
+			{
+				SampleType* write = mDelayBuffer.getWritePointer(channel, mWritePosition + start);
+				for (int i = 0; i < numSamples; ++i)
+					write[i] += mFadeFeedback[start + i] * loop[channel][i];
+			}
+		}
+
+		mFadePosition = jmin(mFadePosition + mNumSamples, mFadeLength);
+	}
 	
-	//called once per getFromDelayBuffer
+	//called once per getFromDelayBuffer: one snapshot acquire, derived values recomputed only when a new version was published
+	//a change of Rate, Feedback, or Wet starts a transition from the old values; changes published during one start the next when it ends
 	void updateBufParams() noexcept
 	{
-		mBufRate = mRate.get();
-		mBufFeedback = mFeedback.get();
-		mBufWet = mWet.get();
+		if (mFadePosition < mFadeLength)
+			return;
+		const auto& parameters = mParameters.acquire();
+		if (mParameters.getVersion() == mBufVersion)
+			return;
+		const bool prepared = mBufVersion != -1;
+		const Configuration from{ mBufRate, mBufFeedback, mBufWet };
+		mBufVersion = mParameters.getVersion();
+		mBufRate = static_cast<int> ((parameters.msRate / 1000.0f) * static_cast<float> (mSampleRate));
+		mBufFeedback = static_cast<SampleType> (parameters.feedback);
+		mBufWet = static_cast<SampleType> (parameters.wet);
+		mFadeLength = roundToInt(parameters.msCrossfade * 0.001f * static_cast<float> (mSampleRate));
+		if (prepared && (from.rate != mBufRate || from.feedback != mBufFeedback || from.wet != mBufWet))
+		{
+			mFadeFrom = from;
+			mFadePosition = 0;
+		}
+		else
+		{
+			mFadePosition = mFadeLength;
+		}
 	}
 
-	//parameters updated via Atomic loads once per buffer
-	int mBufRate = 22050;
-	float mBufFeedback = 0.6f, mBufWet = 0.75f;
+	//parameters derived from the snapshot version mBufVersion (-1 forces an update, e.g. after a sample rate change)
+	int mBufRate = 22050, mBufVersion = -1;
+	SampleType mBufFeedback = static_cast<SampleType> (0.6), mBufWet = static_cast<SampleType> (0.75);
 
-	//instantaneous processing parameters wrapped in Atomic for thread safety (units: num samples, gain, gain)
-	Atomic<int> mRate = 22050;
-	Atomic<float> mFeedback = 0.6f, mWet = 0.75f;
+	//transition state: the configuration faded out, progress in samples, and per block scratch (only touched during a transition)
+	enum { fadeStep = 32 };
+	struct Configuration
+	{
+		int rate;
+		SampleType feedback, wet;
+	};
+	Configuration mFadeFrom{ 22050, static_cast<SampleType> (0.6), static_cast<SampleType> (0.75) };
+	int mFadePosition = 0, mFadeLength = 0;
+	AudioBuffer<SampleType> mFadeBuffer;
+	HeapBlock<SampleType> mFadeIn, mFadeOut, mFadeFeedback;
+
+	//processing parameters published as one coherent set (units: ms, gain, gain, ms)
+	struct Parameters
+	{
+		float msRate = 500.0f, feedback = 0.6f, wet = 0.75f, msCrossfade = 20.0f;
+	};
+	ParameterSnapshot<Parameters> mParameters;
 
 	//environment variables
-	int mSampleRate, mBlockSize, mNumChannels;
+	int mSampleRate = 44100, mBlockSize = 0, mNumChannels = 0;
 };
\ No newline at end of file
@@ -0,0 +1,857 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+//Header-only BBD delay core: standard C++ only (no JUCE), no allocation, and every stage fused into one pass (per sample or per tile)
+//templated on sample type and channel count so a host engine can embed it directly; the delay memory is supplied by the host
+//the plugin does not run BBDChain: its JUCE stages call only the shared math below, and BBDChain (with VoiceBank, see DlayVoiceBank.h)
+//is the chain for hosts without JUCE, scoped to Rate, Feedback, Wet, the BBD filters, Threshold, Attack, Release, Target Waveshaper,
+//Character, the compander, and noise; it advances a sample at a time and switches at block boundaries, and Lookahead, multiband
+//shaping, antialiasing, Detector, Knee, Stereo Link, Crossfade, and the side chain bus are plugin only
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace dlay
+{
+	// Shared Math (also used by the JUCE processors)
+	//==============================================================================
+
+	//decibels to gain with a -100dB floor
+	template <typename T>
+	inline T decibelsToGain(T db) noexcept
+	{
+		return db > T(-100) ? std::pow(T(10), db * T(0.05)) : T(0);
+	}
+
+	//target waveshaper curves: 0 linear, 1 BBD, 2 tube, 3 smashed
+	template <typename T>
+	inline T applyTargetWaveshaper(int choice, T x) noexcept
+	{
+		switch (choice)
+		{
+		case 1: return x - (x * x / T(8)) - (x * x * x / T(16)) + T(0.125); //BBD waveshaper approxmiation
+		case 2:
+		{
+			//Chebyshev Harmonic Matching to 6AU6A Pentode with -90dB noise floor, harmonics boosted 6dB
+			const T t2 = T(2) * x * x - T(1), t3 = T(4) * x * x * x - T(3) * x, t4 = T(8) * x * x * x * x - T(8) * x * x + T(1);
+			return x + decibelsToGain(T(-42)) * t2 + decibelsToGain(T(-68)) * t3 + decibelsToGain(T(-84)) * t4;
+		}
+		case 3: return std::tanh(T(15) * x); //Smashed signal with boosted tanh
+		default: return x; //Linear
+		}
+	}
+
+	//24dB/oct BBD low pass as two cascaded RBJ biquads normalised by a0 (b0, b1, b2, a1, a2 per section)
+	//Butterworth pole pairs; resonance in [0, 1] sharpens the second pair (Q up to ~10); cutoff is kept below 0.45 * sampleRate
+	inline void designBBDFilter(double hzCutoff, double resonance, double sampleRate, double* coefficients) noexcept
+	{
+		const double qs[2] = { 0.54119610, 1.30656296 * (1.0 + 7.0 * resonance) };
+		const double w0 = 2.0 * 3.141592653589793 * std::min(hzCutoff, sampleRate * 0.45) / sampleRate;
+		const double cosW0 = std::cos(w0), sinW0 = std::sin(w0);
+		for (int section = 0; section < 2; ++section)
+		{
+			const double alpha = sinW0 / (2.0 * qs[section]);
+			const double a0 = 1.0 + alpha;
+			double* c = coefficients + section * 5;
+			c[0] = (1.0 - cosW0) * 0.5 / a0;
+			c[1] = (1.0 - cosW0) / a0;
+			c[2] = c[0];
+			c[3] = -2.0 * cosW0 / a0;
+			c[4] = (1.0 - alpha) / a0;
+		}
+	}
+
+	//integer hash with good avalanche (Wellons' lowbias32), the source of the counter-based BBD hiss
+	inline std::uint32_t lowBias32(std::uint32_t x) noexcept
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	//target waveshaper count, BBD filter coefficients (b0, b1, b2, a1, a2 of two sections), bucket count of the emulated MN3005,
+	//waveshaper table intervals over [-1, 1], and compander control interval in samples (int constants, not enumerators, as the clock,
+	//table, and compander ramp math mix them with floating point)
+	constexpr int numTargetWaveshapers = 4, numFilterCoefficients = 10, numStages = 4096, tableSize = 512, controlInterval = 16;
+
+	//NE570 gain cell level for a detector mean square: the expander multiplies by it and the compressor, whose detector senses its own output,
+	//divides by it, so both halves follow the same level and a repeat through both is restored; the -60dB RMS floor bounds the gains to
+	//+-40dB on silence, so a compressed sanitised sample stays finite and below 400 (an onset after silence is compressed by the full gain
+	//until the detector catches up, which is why the delay memory holds the compressed signal unclamped)
+	template <typename SampleType>
+	inline SampleType getCompanderLevel(SampleType meanSquare, SampleType inverseReferenceSquared) noexcept
+	{
+		return std::sqrt(std::max(meanSquare, SampleType(1.0e-6)) * inverseReferenceSquared);
+	}
+
+	//delay memory samples per channel needed at sampleRate (one second plus the write sample)
+	inline int getDelayLength(double sampleRate) noexcept { return static_cast<int> (std::ceil(sampleRate)) + 1; }
+
+	//tabulate every target waveshaper over [-1, 1] into the first numTargetWaveshapers tables (any further tables are morph slots)
+	template <typename SampleType, std::size_t NumTables>
+	inline void buildWaveshaperTables(std::array<std::array<SampleType, tableSize + 1>, NumTables>& tables) noexcept
+	{
+		static_assert(NumTables >= numTargetWaveshapers, "every target waveshaper needs a table");
+		for (int choice = 0; choice < numTargetWaveshapers; ++choice)
+			for (int i = 0; i <= tableSize; ++i)
+				tables[choice][i] = applyTargetWaveshaper(choice, SampleType(-1) + SampleType(2) * SampleType(i) / SampleType(tableSize));
+	}
+
+	//continuous waveshaper position in [0, numTargetWaveshapers - 1]: the target choice plus the Character morph towards the next shapers
+	inline float getWaveshaperPosition(int choice, float character) noexcept
+	{
+		return std::clamp(static_cast<float> (choice) + character, 0.0f, static_cast<float> (numTargetWaveshapers - 1));
+	}
+
+	//waveshaper at a continuous position: the two adjacent curves blended linearly (exactly one curve at whole positions)
+	template <typename T>
+	inline T applyMorphedWaveshaper(float position, T x) noexcept
+	{
+		const int lower = std::min(static_cast<int> (position), numTargetWaveshapers - 1);
+		const T fraction = static_cast<T> (position - static_cast<float> (lower));
+		const T a = applyTargetWaveshaper(lower, x);
+		return fraction == T(0) ? a : a + fraction * (applyTargetWaveshaper(lower + 1, x) - a);
+	}
+
+	//index of the table to look up for a waveshaper position: a target table at whole positions, otherwise morphSlot after blending the
+	//two adjacent target tables into it (once per position change, so a morph costs one lookup per sample like any single shaper)
+	template <typename SampleType, std::size_t NumTables>
+	inline int prepareWaveshaperTable(std::array<std::array<SampleType, tableSize + 1>, NumTables>& tables, float position, int morphSlot) noexcept
+	{
+		const int lower = std::min(static_cast<int> (position), numTargetWaveshapers - 1);
+		const SampleType fraction = static_cast<SampleType> (position - static_cast<float> (lower));
+		if (fraction == SampleType(0))
+			return lower;
+		for (int i = 0; i <= tableSize; ++i)
+			tables[morphSlot][i] = tables[lower][i] + fraction * (tables[lower + 1][i] - tables[lower][i]);
+		return morphSlot;
+	}
+
+	//linearly interpolated table lookup (input clamped to [-1, 1])
+	template <typename SampleType>
+	inline SampleType lookupWaveshaper(const SampleType* table, SampleType x) noexcept
+	{
+		const SampleType position = (std::clamp(x, SampleType(-1), SampleType(1)) + SampleType(1)) * SampleType(tableSize / 2);
+		const int index = std::min(static_cast<int> (position), tableSize - 1);
+		return table[index] + (position - SampleType(index)) * (table[index + 1] - table[index]);
+	}
+
+	//a waveshaper table with the first and second antiderivatives of its linear interpolant (zero at x = 0) for antiderivative
+	//anti-aliasing (ADAA): the integrals are exact, so ADAA agrees with lookupWaveshaper as input steps shrink, works for morph tables
+	//too, and needs no special functions (the second antiderivative of tanh would need a dilogarithm); they are kept in double because
+	//ADAA divides their differences by input steps
+	template <typename SampleType>
+	struct IntegratedWaveshaper
+	{
+		//input steps below this use the limit forms (the difference quotients are ill-conditioned there)
+		static constexpr double tolerance = 1.0e-5;
+
+		std::array<SampleType, tableSize + 1> table{};
+		std::array<double, tableSize + 1> first{}, second{};
+
+		//tabulate the waveshaper at position (see getWaveshaperPosition) and integrate it
+		void build(float position) noexcept
+		{
+			for (int i = 0; i <= tableSize; ++i)
+				table[i] = applyMorphedWaveshaper(position, SampleType(-1) + SampleType(2) * SampleType(i) / SampleType(tableSize));
+			integrate();
+		}
+
+		//the curve at position blended from the target curves (see getTargets): the integrals are linear in the table, so this is build
+		//up to rounding, at the cost of one blend per entry instead of evaluating and integrating the curve (cheap enough for the audio thread)
+		void morph(float position) noexcept
+		{
+			const auto& targets = getTargets();
+			const int lower = std::min(static_cast<int> (position), numTargetWaveshapers - 1);
+			const SampleType fraction = static_cast<SampleType> (position - static_cast<float> (lower));
+			if (fraction == SampleType(0))
+			{
+				*this = targets[lower];
+				return;
+			}
+			const IntegratedWaveshaper& a = targets[lower];
+			const IntegratedWaveshaper& b = targets[lower + 1];
+			const double f = static_cast<double> (fraction);
+			for (int i = 0; i <= tableSize; ++i)
+			{
+				table[i] = a.table[i] + fraction * (b.table[i] - a.table[i]);
+				first[i] = a.first[i] + f * (b.first[i] - a.first[i]);
+				second[i] = a.second[i] + f * (b.second[i] - a.second[i]);
+			}
+		}
+
+		//every target waveshaper, built and integrated on first use (first use it off the audio thread)
+		static const std::array<IntegratedWaveshaper, numTargetWaveshapers>& getTargets() noexcept
+		{
+			static const std::array<IntegratedWaveshaper, numTargetWaveshapers> targets = []() noexcept
+			{
+				std::array<IntegratedWaveshaper, numTargetWaveshapers> curves;
+				for (int choice = 0; choice < numTargetWaveshapers; ++choice)
+					curves[choice].build(static_cast<float> (choice));
+				return curves;
+			}();
+			return targets;
+		}
+
+		//integrate table exactly, piece by piece, then move the origin to x = 0 (smaller values, less cancellation)
+		void integrate() noexcept
+		{
+			const double h = 2.0 / tableSize;
+			first[0] = second[0] = 0.0;
+			for (int i = 0; i < tableSize; ++i)
+			{
+				const double a = table[i], b = table[i + 1];
+				first[i + 1] = first[i] + h * (a + b) * 0.5;
+				second[i + 1] = second[i] + h * first[i] + h * h * (2.0 * a + b) / 6.0;
+			}
+			const double firstAtZero = first[tableSize / 2], secondAtZero = second[tableSize / 2];
+			for (int i = 0; i <= tableSize; ++i)
+			{
+				second[i] -= secondAtZero + firstAtZero * (-1.0 + h * i);
+				first[i] -= firstAtZero;
+			}
+		}
+
+		//the curve and its antiderivatives at x (branch free; beyond [-1, 1] the clamped curve is constant, so the first antiderivative
+		//continues linearly and the second quadratically)
+		double value(double x) const noexcept
+		{
+			int k;
+			double t;
+			locate(x, k, t);
+			return table[k] + (table[k + 1] - table[k]) * t * (tableSize / 2);
+		}
+		double antiderivative(double x) const noexcept
+		{
+			const double clamped = std::clamp(x, -1.0, 1.0), u = x - clamped;
+			int k;
+			double t;
+			locate(clamped, k, t);
+			const double slope = (table[k + 1] - table[k]) * (tableSize / 2);
+			return first[k] + table[k] * t + slope * t * t * 0.5 + (table[k] + slope * t) * u;
+		}
+		double secondAntiderivative(double x) const noexcept
+		{
+			const double clamped = std::clamp(x, -1.0, 1.0), u = x - clamped;
+			int k;
+			double t;
+			locate(clamped, k, t);
+			const double slope = (table[k + 1] - table[k]) * (tableSize / 2);
+			const double f = table[k] + slope * t, F = first[k] + table[k] * t + slope * t * t * 0.5;
+			return second[k] + first[k] * t + table[k] * t * t * 0.5 + slope * t * t * t / 6.0 + F * u + f * u * u * 0.5;
+		}
+
+		//first order ADAA of the step from x1 to x0 (half a sample of delay)
+		double adaa1(double x0, double x1) const noexcept
+		{
+			const double d = x0 - x1;
+			const bool safe = std::abs(d) > tolerance;
+			const double quotient = (antiderivative(x0) - antiderivative(x1)) / (safe ? d : 1.0);
+			return safe ? quotient : value(0.5 * (x0 + x1));
+		}
+
+		//second order ADAA over x2, x1, x0 (one sample of delay), with the limit forms of Parker, Zavalishin, and Le Bivic (DAFx 2016)
+		double adaa2(double x0, double x1, double x2) const noexcept
+		{
+			const double d = x0 - x2;
+			if (std::abs(d) > tolerance)
+				return 2.0 * (divided(x0, x1) - divided(x1, x2)) / d;
+			const double mean = 0.5 * (x0 + x2), delta = mean - x1;
+			if (std::abs(delta) > tolerance)
+				return 2.0 / delta * (antiderivative(mean) + (secondAntiderivative(x1) - secondAntiderivative(mean)) / delta);
+			return value(0.5 * (mean + x1));
+		}
+
+		//first and second order ADAA of the identity (the dry part of a dynamic blend goes through the same delay)
+		static double identity1(double x0, double x1) noexcept { return 0.5 * (x0 + x1); }
+		static double identity2(double x0, double x1, double x2) noexcept { return (x0 + x1 + x2) * (1.0 / 3.0); }
+
+	private:
+
+		//table interval of x in [-1, 1] and offset into it
+		static void locate(double x, int& k, double& t) noexcept
+		{
+			x = std::clamp(x, -1.0, 1.0);
+			const double position = (x + 1.0) * (tableSize / 2);
+			k = std::min(static_cast<int> (position), tableSize - 1);
+			t = x - (-1.0 + 2.0 * k / tableSize);
+		}
+
+		//divided difference of the second antiderivative (its limit is the first antiderivative at the midpoint)
+		double divided(double a, double b) const noexcept
+		{
+			const double d = a - b;
+			return std::abs(d) > tolerance ? (secondAntiderivative(a) - secondAntiderivative(b)) / d : antiderivative(0.5 * (a + b));
+		}
+	};
+
+	//clean non-finite, near-denormal (below -300dB), and runaway (above +12dB) samples before they reach delay memory
+	//(branch free so loops over it vectorise; x - x is NaN only for infinities and NaN)
+	template <typename SampleType>
+	inline SampleType sanitise(SampleType x) noexcept
+	{
+		const SampleType clean = (x - x == SampleType(0) && std::abs(x) >= SampleType(1.0e-15)) ? x : SampleType(0);
+		return std::min(std::max(clean, SampleType(-4)), SampleType(4));
+	}
+
+	// Parameters
+	//==============================================================================
+
+	//every control of the chain in plain units (same ranges as the plugin parameters)
+	struct Parameters
+	{
+		float rateMs = 150.0f, feedbackDb = -15.0f, wetPercent = 50.0f;
+		float cutoffHz = 2000.0f, resonance = 0.1f;
+		float thresholdDb = -30.0f, attackMs = 50.0f, releaseMs = 100.0f;
+		int targetWaveshaper = 0;
+		float character = 0.0f;
+		bool analog = true, compander = false, noise = false;
+		float hissDb = -80.0f, clockBleedDb = -90.0f;
+		std::uint32_t seed = 0x0d1a7;
+
+		bool operator== (const Parameters& other) const noexcept
+		{
+			return rateMs == other.rateMs && feedbackDb == other.feedbackDb && wetPercent == other.wetPercent
+				&& cutoffHz == other.cutoffHz && resonance == other.resonance
+				&& thresholdDb == other.thresholdDb && attackMs == other.attackMs && releaseMs == other.releaseMs
+				&& targetWaveshaper == other.targetWaveshaper && character == other.character && analog == other.analog && compander == other.compander && noise == other.noise
+				&& hissDb == other.hissDb && clockBleedDb == other.clockBleedDb && seed == other.seed;
+		}
+		bool operator!= (const Parameters& other) const noexcept { return !(*this == other); }
+	};
+
+	//Parameters turned into per sample values at a sample rate (shared by every engine so they agree exactly)
+	template <typename SampleType>
+	struct Coefficients
+	{
+		int rate = 0;
+		float shaperPosition = 0.0f;
+		SampleType feedback = 0, wet = 0, threshold = 0, attackCoeff = 0, releaseCoeff = 0;
+		SampleType companderCoeff = 0, inverseReferenceSquared = 1, hissAmplitude = 0, clockAmplitude = 0;
+		std::array<SampleType, numFilterCoefficients> filter{};
+		std::uint32_t clockIncrement = 0;
+
+		void compute(const Parameters& parameters, double sampleRate) noexcept
+		{
+			//delay line (same sample rounding as the modular DelayLine)
+			rate = std::clamp(static_cast<int> ((parameters.rateMs / 1000.0f) * static_cast<float> (static_cast<int> (sampleRate))), 0, getDelayLength(sampleRate) - 1);
+			feedback = decibelsToGain(static_cast<SampleType> (parameters.feedbackDb));
+			wet = static_cast<SampleType> (parameters.wetPercent / 100.0f);
+
+			//BBD filter
+			double designed[numFilterCoefficients];
+			designBBDFilter(parameters.cutoffHz, parameters.resonance, sampleRate, designed);
+			for (int i = 0; i < numFilterCoefficients; ++i)
+				filter[i] = static_cast<SampleType> (designed[i]);
+
+			//dynamic waveshaper
+			threshold = decibelsToGain(static_cast<SampleType> (parameters.thresholdDb));
+			attackCoeff = static_cast<SampleType> (std::exp(-1000.0 / (parameters.attackMs * sampleRate)));
+			releaseCoeff = static_cast<SampleType> (std::exp(-1000.0 / (parameters.releaseMs * sampleRate)));
+			shaperPosition = getWaveshaperPosition(std::clamp(parameters.targetWaveshaper, 0, numTargetWaveshapers - 1), parameters.character);
+
+			//compander (NE570 typical: 10ms detector, unity gain at -20dBFS)
+			companderCoeff = static_cast<SampleType> (std::exp(-1000.0 / (10.0 * sampleRate)));
+			inverseReferenceSquared = SampleType(1) / (decibelsToGain(SampleType(-20)) * decibelsToGain(SampleType(-20)));
+
+			//noise (clock = stages / (2 * delay), silent above Nyquist)
+			hissAmplitude = decibelsToGain(static_cast<SampleType> (parameters.hissDb)) * static_cast<SampleType> (std::sqrt(3.0));
+			clockAmplitude = decibelsToGain(static_cast<SampleType> (parameters.clockBleedDb));
+			const double hzClock = (parameters.rateMs > 0.0f) ? numStages / (2.0 * parameters.rateMs / 1000.0) : 0.0;
+			clockIncrement = (hzClock > 0.0 && hzClock < sampleRate * 0.5) ? static_cast<std::uint32_t> (hzClock / sampleRate * 4294967296.0) : 0u;
+		}
+	};
+
+	// BBDChain
+	//==============================================================================
+
+	//the whole D-lay chain for NumChannels channels: write path (BBD filter, dynamic waveshaper, compressor), delay memory with feedback,
+	//and wet path (hiss and clock bleed, expander, BBD filter); feedback is taken from the delay memory, or after the expander and compressed
+	//again with the input when the compander is on; the delay is sample accurate, so rates below the block size behave like any other
+	template <typename SampleType, int NumChannels>
+	class BBDChain
+	{
+	public:
+
+		static constexpr int numChannels = NumChannels;
+
+		//delay memory samples per channel needed at sampleRate
+		static int getDelayLength(double sampleRate) noexcept { return dlay::getDelayLength(sampleRate); }
+
+		// Essential Methods
+		//==============================================================================
+
+		//save sample rate and delay memory (NumChannels * getDelayLength(sampleRate) samples, owned by the caller), build tables, and clear state
+		void prepare(double sampleRate, SampleType* delayMemory) noexcept
+		{
+			mSampleRate = sampleRate;
+			mDelayLength = getDelayLength(sampleRate);
+			mDelay = delayMemory;
+			mChunkSize = std::max(1, static_cast<int> (sampleRate / 100.0)); //envelope chunks sampled at 100Hz
+
+			buildWaveshaperTables(mTables);
+
+			mHaveParameters = false;
+			setParameters(mParameters);
+			reset();
+		}
+
+		//clear delay memory and every stage's state
+		void reset() noexcept
+		{
+			std::fill(mDelay, mDelay + NumChannels * mDelayLength, SampleType(0));
+			mWritePosition = 0;
+			for (auto& state : mAAState) state.fill(SampleType(0));
+			for (auto& state : mReconstructionState) state.fill(SampleType(0));
+			mEnvelope.fill(SampleType(0));
+			mChunkMax.fill(SampleType(0));
+			mThresholdIn.fill(SampleType(0));
+			mChunkCounter = 0;
+			mCompressor.reset();
+			mExpander.reset();
+			mCompanderCounter = 0;
+			mNoiseCounter = 0;
+			mClockPhase = 0;
+		}
+
+		//take new parameters (call once per block; coefficients are only recomputed when something changed)
+		void setParameters(const Parameters& parameters) noexcept
+		{
+			if (mHaveParameters && parameters == mParameters)
+				return;
+			mParameters = parameters;
+			mHaveParameters = true;
+
+			mCoefficients.compute(parameters, mSampleRate);
+			mTable = prepareWaveshaperTable(mTables, mCoefficients.shaperPosition, numTargetWaveshapers);
+		}
+
+		//process channels in place, one sample of every stage at a time
+		void process(SampleType* const* channels, int numSamples) noexcept { dispatch<false>(channels, numSamples); }
+
+		//process channels in place one tile at a time: every stage runs over a short tile of every channel while it sits in L1, so the loops
+		//without recurrences (delay copies, feedback, noise, mix) vectorise; output is identical to process
+		void processTiled(SampleType* const* channels, int numSamples) noexcept { dispatch<true>(channels, numSamples); }
+
+		//last envelope value of a channel (for meters)
+		SampleType getEnvelope(int channel) const noexcept { return mEnvelope[channel]; }
+
+	private:
+
+		enum { filterStateSize = 4, tileSize = 64 };
+
+		//one tile of every channel
+		using Tile = std::array<std::array<SampleType, tileSize>, NumChannels>;
+
+		//pick the instantiation for the enabled stages so the inner loops have no stage branches
+		template <bool Tiled>
+		void dispatch(SampleType* const* channels, int numSamples) noexcept
+		{
+			const int stages = (mParameters.analog ? 1 : 0) | (mParameters.compander ? 2 : 0) | (mParameters.noise ? 4 : 0);
+			switch (stages)
+			{
+			case 0: run<Tiled, false, false, false>(channels, numSamples); break;
+			case 1: run<Tiled, true, false, false>(channels, numSamples); break;
+			case 2: run<Tiled, false, true, false>(channels, numSamples); break;
+			case 3: run<Tiled, true, true, false>(channels, numSamples); break;
+			case 4: run<Tiled, false, false, true>(channels, numSamples); break;
+			case 5: run<Tiled, true, false, true>(channels, numSamples); break;
+			case 6: run<Tiled, false, true, true>(channels, numSamples); break;
+			default: run<Tiled, true, true, true>(channels, numSamples); break;
+			}
+		}
+
+		template <bool Tiled, bool Analog, bool Compander, bool Noise>
+		void run(SampleType* const* channels, int numSamples) noexcept
+		{
+			if constexpr (Tiled)
+				processTiles<Analog, Compander, Noise>(channels, numSamples);
+			else
+				processStages<Analog, Compander, Noise>(channels, numSamples);
+		}
+
+		//one pass over every sample of every stage
+		template <bool Analog, bool Compander, bool Noise>
+		void processStages(SampleType* const* channels, int numSamples) noexcept
+		{
+			const SampleType* table = mTables[mTable].data();
+			for (int i = 0; i < numSamples; ++i)
+			{
+				//compander gains ramp towards a new target every controlInterval samples
+				if (Compander && mCompanderCounter == 0)
+				{
+					mCompressor.updateTargets(mCoefficients.inverseReferenceSquared);
+					mExpander.updateTargets(mCoefficients.inverseReferenceSquared);
+				}
+				int readPosition = mWritePosition - getLoopRate<Compander>();
+				if (readPosition < 0)
+					readPosition += mDelayLength;
+
+				for (int channel = 0; channel < NumChannels; ++channel)
+				{
+					const SampleType x = channels[channel][i];
+					SampleType* line = mDelay + channel * mDelayLength;
+
+					//write path
+					SampleType w = x;
+					if (Analog)
+					{
+						w = processFilter(mAAState[channel], w);
+						w = processWaveshaper(channel, w, table);
+					}
+
+					//feedback and wet path up to the reconstruction filter
+					SampleType r;
+					if (Compander)
+					{
+						//the loop closes after the expander: the delayed sample is expanded (hiss and clock included) and compressed again with
+						//the input, so every repeat is compressed and expanded exactly once; only the compressor's input is sanitised, as the
+						//compressed write may exceed the clamp (by up to the +40dB gain on silence) and the expander restores it
+						r = line[readPosition];
+						if (Noise)
+							r = addNoise(channel, r);
+						r = mExpander.process(channel, r, mCoefficients.companderCoeff);
+						line[mWritePosition] = mCompressor.process(channel, sanitise(w + mCoefficients.feedback * r), mCoefficients.companderCoeff);
+					}
+					else
+					{
+						//the delay memory recirculates as it is (reads the sample just written when Rate is 0)
+						line[mWritePosition] = sanitise(w);
+						r = line[readPosition];
+						line[mWritePosition] = sanitise(line[mWritePosition] + mCoefficients.feedback * r);
+						if (Noise)
+							r = addNoise(channel, r);
+					}
+					if (Analog)
+						r = processFilter(mReconstructionState[channel], r);
+					channels[channel][i] = x + mCoefficients.wet * r;
+				}
+
+				if (Analog && ++mChunkCounter == mChunkSize)
+					updateThresholds();
+				if (Compander && ++mCompanderCounter == controlInterval)
+					mCompanderCounter = 0;
+				if (Noise)
+				{
+					++mNoiseCounter;
+					mClockPhase += mCoefficients.clockIncrement;
+				}
+				if (++mWritePosition == mDelayLength)
+					mWritePosition = 0;
+			}
+		}
+
+		//each stage over a tile of every channel (channels innermost, so recurrences of different channels overlap and the loops without
+		//recurrences vectorise); tiles stop at the end of the delay memory and never exceed Rate, so every delayed sample a tile reads is
+		//final before the tile starts (Rate 0 reads the sample just written, as in processStages)
+		template <bool Analog, bool Compander, bool Noise>
+		void processTiles(SampleType* const* channels, int numSamples) noexcept
+		{
+			const SampleType* table = mTables[mTable].data();
+			const int rate = getLoopRate<Compander>();
+			Tile write, delayed;
+			for (int start = 0; start < numSamples;)
+			{
+				int readPosition = mWritePosition - rate;
+				if (readPosition < 0)
+					readPosition += mDelayLength;
+				const int maxTile = (rate == 0 || rate >= tileSize) ? static_cast<int> (tileSize) : rate;
+				const int n = std::min({ numSamples - start, maxTile, mDelayLength - mWritePosition, mDelayLength - readPosition });
+
+				//read before writing: when Rate is near the delay length the read segment lies just ahead of the write segment
+				for (int channel = 0; channel < NumChannels; ++channel)
+				{
+					std::copy(channels[channel] + start, channels[channel] + start + n, write[channel].data());
+					if (rate != 0)
+						std::copy(getLine(channel, readPosition), getLine(channel, readPosition) + n, delayed[channel].data());
+				}
+
+				//write path
+				if (Analog)
+				{
+					processFilterTile(mAAState, write, n);
+					for (int i = 0; i < n; ++i)
+					{
+						for (int channel = 0; channel < NumChannels; ++channel)
+							write[channel][i] = processWaveshaper(channel, write[channel][i], table);
+						if (++mChunkCounter == mChunkSize)
+							updateThresholds();
+					}
+				}
+				if (Compander)
+				{
+					//the loop closes after the expander (see processStages)
+					addNoiseTile<Noise>(delayed, n);
+					mExpander.processTile(delayed, n, mCompanderCounter, mCoefficients.companderCoeff, mCoefficients.inverseReferenceSquared);
+					for (int channel = 0; channel < NumChannels; ++channel)
+						for (int i = 0; i < n; ++i)
+							write[channel][i] = sanitise(write[channel][i] + mCoefficients.feedback * delayed[channel][i]);
+					mCompressor.processTile(write, n, mCompanderCounter, mCoefficients.companderCoeff, mCoefficients.inverseReferenceSquared);
+					for (int channel = 0; channel < NumChannels; ++channel)
+						std::copy(write[channel].data(), write[channel].data() + n, getLine(channel, mWritePosition));
+				}
+				else
+				{
+					for (int channel = 0; channel < NumChannels; ++channel)
+					{
+						SampleType* line = getLine(channel, mWritePosition);
+						for (int i = 0; i < n; ++i)
+							line[i] = sanitise(write[channel][i]);
+					}
+
+					//feedback
+					for (int channel = 0; channel < NumChannels; ++channel)
+					{
+						SampleType* line = getLine(channel, mWritePosition);
+						if (rate == 0)
+							std::copy(line, line + n, delayed[channel].data());
+						for (int i = 0; i < n; ++i)
+							line[i] = sanitise(line[i] + mCoefficients.feedback * delayed[channel][i]);
+					}
+					addNoiseTile<Noise>(delayed, n);
+				}
+
+				//rest of the wet path
+				if (Analog)
+					processFilterTile(mReconstructionState, delayed, n);
+				for (int channel = 0; channel < NumChannels; ++channel)
+				{
+					SampleType* x = channels[channel] + start;
+					for (int i = 0; i < n; ++i)
+						x[i] += mCoefficients.wet * delayed[channel][i];
+				}
+
+				if (Compander)
+					mCompanderCounter = (mCompanderCounter + n) % controlInterval;
+				mWritePosition += n;
+				if (mWritePosition == mDelayLength)
+					mWritePosition = 0;
+				start += n;
+			}
+		}
+
+		//delay memory of a channel starting at position
+		SampleType* getLine(int channel, int position) const noexcept { return mDelay + channel * mDelayLength + position; }
+
+		//Rate of the feedback loop: a loop through the compander needs a sample of delay, so Rate 0 reads the previous sample there
+		template <bool Compander>
+		int getLoopRate() const noexcept { return Compander ? std::max(mCoefficients.rate, 1) : mCoefficients.rate; }
+
+		//add hiss and clock bleed to a tile of every channel and advance the noise counters (nothing without Noise)
+		template <bool Noise>
+		void addNoiseTile(Tile& tile, int numSamples) noexcept
+		{
+			if (!Noise)
+				return;
+			for (int channel = 0; channel < NumChannels; ++channel)
+				addNoiseTile(channel, tile[channel].data(), numSamples);
+			mNoiseCounter += static_cast<std::uint32_t> (numSamples);
+			mClockPhase += mCoefficients.clockIncrement * static_cast<std::uint32_t> (numSamples);
+		}
+
+		//two transposed direct form II biquads
+		SampleType processFilter(std::array<SampleType, filterStateSize>& state, SampleType x) const noexcept
+		{
+			for (int section = 0; section < 2; ++section)
+			{
+				const SampleType* c = mCoefficients.filter.data() + section * 5;
+				const SampleType y = c[0] * x + state[section * 2];
+				state[section * 2] = c[1] * x - c[3] * y + state[section * 2 + 1];
+				state[section * 2 + 1] = c[2] * x - c[4] * y;
+				x = y;
+			}
+			return x;
+		}
+
+		//both biquads over a tile of every channel, one section at a time
+		void processFilterTile(std::array<std::array<SampleType, filterStateSize>, NumChannels>& state, Tile& tile, int numSamples) const noexcept
+		{
+			for (int section = 0; section < 2; ++section)
+			{
+				const SampleType* c = mCoefficients.filter.data() + section * 5;
+				const SampleType b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+				std::array<SampleType, NumChannels> s1, s2;
+				for (int channel = 0; channel < NumChannels; ++channel)
+				{
+					s1[channel] = state[channel][section * 2];
+					s2[channel] = state[channel][section * 2 + 1];
+				}
+				for (int i = 0; i < numSamples; ++i)
+				{
+					for (int channel = 0; channel < NumChannels; ++channel)
+					{
+						const SampleType x = tile[channel][i];
+						const SampleType y = b0 * x + s1[channel];
+						s1[channel] = b1 * x - a1 * y + s2[channel];
+						s2[channel] = b2 * x - a2 * y;
+						tile[channel][i] = y;
+					}
+				}
+				for (int channel = 0; channel < NumChannels; ++channel)
+				{
+					state[channel][section * 2] = s1[channel];
+					state[channel][section * 2 + 1] = s2[channel];
+				}
+			}
+		}
+
+		//thresholded, smoothed envelope blends the input towards the target waveshaper (table lookup with linear interpolation)
+		SampleType processWaveshaper(int channel, SampleType x, const SampleType* table) noexcept
+		{
+			mChunkMax[channel] = std::max(mChunkMax[channel], std::abs(x));
+			const SampleType coeff = (mThresholdIn[channel] > mEnvelope[channel]) ? mCoefficients.attackCoeff : mCoefficients.releaseCoeff;
+			mEnvelope[channel] = coeff * mEnvelope[channel] + (SampleType(1) - coeff) * mThresholdIn[channel];
+
+			const SampleType shaped = lookupWaveshaper(table, x);
+			return x + mEnvelope[channel] * (shaped - x);
+		}
+
+		//threshold each channel's chunk maximum and start the next chunk
+		void updateThresholds() noexcept
+		{
+			mChunkCounter = 0;
+			for (int channel = 0; channel < NumChannels; ++channel)
+			{
+				mThresholdIn[channel] = (mChunkMax[channel] > mCoefficients.threshold) ? SampleType(1) : SampleType(0);
+				mChunkMax[channel] = SampleType(0);
+			}
+		}
+
+		//add counter-based hiss, then triangle clock bleed, to x (same order and values as the modular BBDNoise for the same seed)
+		SampleType addNoise(int channel, SampleType x) const noexcept
+		{
+			const std::uint32_t hash = lowBias32(lowBias32(mNoiseCounter ^ getNoiseKey(channel)));
+			x += mCoefficients.hissAmplitude * (static_cast<SampleType> (static_cast<std::int32_t> (hash)) * static_cast<SampleType> (1.0 / 2147483648.0));
+			if (mCoefficients.clockIncrement != 0)
+			{
+				const std::int32_t folded = static_cast<std::int32_t> ((mClockPhase ^ static_cast<std::uint32_t> (static_cast<std::int32_t> (mClockPhase) >> 31)) - 0x40000000u);
+				x += mCoefficients.clockAmplitude * (static_cast<SampleType> (folded) * static_cast<SampleType> (1.0 / 1073741824.0));
+			}
+			return x;
+		}
+
+		//add a tile of noise to one channel (hiss and clock loops carry no state, so both vectorise)
+		void addNoiseTile(int channel, SampleType* data, int numSamples) const noexcept
+		{
+			const std::uint32_t key = getNoiseKey(channel);
+			for (int i = 0; i < numSamples; ++i)
+			{
+				const std::uint32_t hash = lowBias32(lowBias32((mNoiseCounter + static_cast<std::uint32_t> (i)) ^ key));
+				data[i] += mCoefficients.hissAmplitude * (static_cast<SampleType> (static_cast<std::int32_t> (hash)) * static_cast<SampleType> (1.0 / 2147483648.0));
+			}
+			if (mCoefficients.clockIncrement != 0)
+			{
+				for (int i = 0; i < numSamples; ++i)
+				{
+					const std::uint32_t phase = mClockPhase + mCoefficients.clockIncrement * static_cast<std::uint32_t> (i);
+					const std::int32_t folded = static_cast<std::int32_t> ((phase ^ static_cast<std::uint32_t> (static_cast<std::int32_t> (phase) >> 31)) - 0x40000000u);
+					data[i] += mCoefficients.clockAmplitude * (static_cast<SampleType> (folded) * static_cast<SampleType> (1.0 / 1073741824.0));
+				}
+			}
+		}
+
+		std::uint32_t getNoiseKey(int channel) const noexcept
+		{
+			return mParameters.seed ^ (static_cast<std::uint32_t> (channel + 1) * 0x9e3779b9u);
+		}
+
+		//one half of the NE570 compander: mean square detector and a gain cell level ramped over controlInterval samples (see getCompanderLevel)
+		template <bool Compress>
+		struct CompanderHalf
+		{
+			std::array<SampleType, NumChannels> meanSquare, level, step;
+
+			void reset() noexcept
+			{
+				meanSquare.fill(SampleType(0));
+				level.fill(SampleType(1));
+				step.fill(SampleType(0));
+			}
+
+			void updateTargets(SampleType inverseReferenceSquared) noexcept
+			{
+				for (int channel = 0; channel < NumChannels; ++channel)
+					step[channel] = (getCompanderLevel(meanSquare[channel], inverseReferenceSquared) - level[channel]) * SampleType(1.0 / controlInterval);
+			}
+
+			//process a tile of every channel starting at control counter (state is kept in locals so the tile stores cannot alias it)
+			void processTile(Tile& tile, int numSamples, int counter, SampleType coeff, SampleType inverseReferenceSquared) noexcept
+			{
+				for (int i = 0; i < numSamples;)
+				{
+					if (counter == 0)
+						updateTargets(inverseReferenceSquared);
+					const int length = std::min(numSamples - i, controlInterval - counter);
+					for (int channel = 0; channel < NumChannels; ++channel)
+					{
+						SampleType ms = meanSquare[channel], l = level[channel];
+						const SampleType st = step[channel];
+						SampleType* data = tile[channel].data() + i;
+						for (int j = 0; j < length; ++j)
+							data[j] = processSample(data[j], ms, l, st, coeff);
+						meanSquare[channel] = ms;
+						level[channel] = l;
+					}
+					i += length;
+					counter = (counter + length) % controlInterval;
+				}
+			}
+
+			SampleType process(int channel, SampleType x, SampleType coeff) noexcept
+			{
+				return processSample(x, meanSquare[channel], level[channel], step[channel], coeff);
+			}
+
+			//the compressor detects its output (2:1 as the level follows the square root of the input), the expander its input (1:2)
+			static SampleType processSample(SampleType x, SampleType& ms, SampleType& l, SampleType st, SampleType coeff) noexcept
+			{
+				if (Compress)
+				{
+					l += st;
+					const SampleType y = x / l;
+					ms = coeff * ms + (SampleType(1) - coeff) * y * y;
+					return y;
+				}
+				ms = coeff * ms + (SampleType(1) - coeff) * x * x;
+				l += st;
+				return x * l;
+			}
+		};
+
+		//target waveshaper tables, the morph slot, and the table in use
+		std::array<std::array<SampleType, tableSize + 1>, numTargetWaveshapers + 1> mTables;
+		int mTable = 0;
+
+		//state
+		SampleType* mDelay = nullptr;
+		int mDelayLength = 0, mWritePosition = 0;
+		std::array<std::array<SampleType, filterStateSize>, NumChannels> mAAState{}, mReconstructionState{};
+		std::array<SampleType, NumChannels> mEnvelope{}, mChunkMax{}, mThresholdIn{};
+		int mChunkSize = 441, mChunkCounter = 0, mCompanderCounter = 0;
+		CompanderHalf<true> mCompressor;
+		CompanderHalf<false> mExpander;
+		std::uint32_t mNoiseCounter = 0, mClockPhase = 0;
+
+		//derived parameters
+		Parameters mParameters;
+		bool mHaveParameters = false;
+		Coefficients<SampleType> mCoefficients;
+
+		//environment variables
+		double mSampleRate = 44100.0;
+	};
+}
@@ -0,0 +1,398 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+//Header-only bank of independent mono D-lay voices for hosts running many instances (sends, stems): standard C++ only, no allocation
+#include "DlayCore.h"
+
+namespace dlay
+{
+	// VoiceBank
+	//==============================================================================
+
+	//up to MaxVoices independent voices, each with its own delay memory, parameters, envelope, and compander, in structure of arrays form:
+	//voices run in batches of one vector of lanes, and every stage loops over a batch innermost on contiguous per voice state, so one sample
+	//of a stage for a batch is one vector operation; a voice's disabled stages are selected around rather than branched on, passing the signal
+	//through and freezing their state and counters as BBDChain does when it skips them, so every voice gives exactly the output of a mono
+	//BBDChain given the same Parameters, however its stages are switched
+	template <typename SampleType, int MaxVoices>
+	class VoiceBank
+	{
+	public:
+
+		static constexpr int maxVoices = MaxVoices;
+
+		//delay memory samples per voice needed at sampleRate
+		static int getDelayLength(double sampleRate) noexcept { return dlay::getDelayLength(sampleRate); }
+
+		// Essential Methods
+		//==============================================================================
+
+		//save sample rate and delay memory (MaxVoices * getDelayLength(sampleRate) samples, owned by the caller), build tables, and clear state
+		void prepare(double sampleRate, SampleType* delayMemory) noexcept
+		{
+			mSampleRate = sampleRate;
+			mDelayLength = getDelayLength(sampleRate);
+			mDelay = delayMemory;
+			mChunkSize = std::max(1, static_cast<int> (sampleRate / 100.0)); //envelope chunks sampled at 100Hz
+			buildWaveshaperTables(mTables);
+
+			for (int voice = 0; voice < MaxVoices; ++voice)
+			{
+				mHaveParameters[voice] = false;
+				setVoiceParameters(voice, mParameters[voice], mNoiseChannel[voice]);
+			}
+			reset();
+		}
+
+		//clear delay memory and every voice's state
+		void reset() noexcept
+		{
+			std::fill(mDelay, mDelay + MaxVoices * mDelayLength, SampleType(0));
+			mWritePosition = 0;
+			for (auto& state : mAAState) state.fill(SampleType(0));
+			for (auto& state : mReconstructionState) state.fill(SampleType(0));
+			mEnvelope.fill(SampleType(0));
+			mChunkMax.fill(SampleType(0));
+			mThresholdIn.fill(SampleType(0));
+			mChunkCounter.fill(0);
+			mCompressor.reset();
+			mExpander.reset();
+			mCompanderCounter.fill(0);
+			mNoiseCounter.fill(0u);
+			mClockPhase.fill(0u);
+		}
+
+		//take new parameters for a voice (call between process calls; recomputed only when something changed)
+		//noiseChannel picks the hiss stream a BBDChain channel of that index would use, so a stereo pair of voices matches a stereo BBDChain
+		void setVoiceParameters(int voice, const Parameters& parameters, int noiseChannel = 0) noexcept
+		{
+			if (mHaveParameters[voice] && parameters == mParameters[voice] && noiseChannel == mNoiseChannel[voice])
+				return;
+			mParameters[voice] = parameters;
+			mNoiseChannel[voice] = noiseChannel;
+			mHaveParameters[voice] = true;
+
+			Coefficients<SampleType> coefficients;
+			coefficients.compute(parameters, mSampleRate);
+
+			//delay line (the loop through the compander needs a sample of delay, and takes its feedback after the expander, see BBDChain)
+			mRate[voice] = parameters.compander ? std::max(coefficients.rate, 1) : coefficients.rate;
+			mMemoryFeedback[voice] = parameters.compander ? SampleType(0) : coefficients.feedback;
+			mLoopFeedback[voice] = parameters.compander ? coefficients.feedback : SampleType(0);
+			mWet[voice] = coefficients.wet;
+
+			//BBD filters and dynamic waveshaper
+			mAnalog[voice] = parameters.analog;
+			for (int i = 0; i < numFilterCoefficients; ++i)
+				mFilter[i][voice] = coefficients.filter[i];
+			mThreshold[voice] = coefficients.threshold;
+			mAttackCoeff[voice] = coefficients.attackCoeff;
+			mReleaseCoeff[voice] = coefficients.releaseCoeff;
+			mTable[voice] = prepareWaveshaperTable(mTables, coefficients.shaperPosition, numTargetWaveshapers + voice);
+
+			//compander
+			mCompanderOn[voice] = parameters.compander;
+			mCompanderCoeff[voice] = coefficients.companderCoeff;
+			mInverseReferenceSquared[voice] = coefficients.inverseReferenceSquared;
+
+			//noise (the clock only sounds while it runs, as in BBDChain)
+			mNoiseOn[voice] = parameters.noise;
+			mNoiseKey[voice] = parameters.seed ^ (static_cast<std::uint32_t> (noiseChannel + 1) * 0x9e3779b9u);
+			mHissAmplitude[voice] = coefficients.hissAmplitude;
+			mClockAmplitude[voice] = (coefficients.clockIncrement != 0) ? coefficients.clockAmplitude : SampleType(0);
+			mClockIncrement[voice] = coefficients.clockIncrement;
+		}
+
+		//process the first numVoices voices in place (voices[v] holds numSamples samples of voice v), one batch of lanes at a time
+		void process(SampleType* const* voices, int numVoices, int numSamples) noexcept
+		{
+			const int n = std::min(numVoices, MaxVoices);
+			const int writePosition = mWritePosition;
+			for (int start = 0; start < n; start += lanes)
+			{
+				//every batch starts from the same write position (all other counters are per voice)
+				mWritePosition = writePosition;
+				processBatch(voices + start, std::min(static_cast<int> (lanes), n - start), start, numSamples);
+			}
+		}
+
+		//voices per batch: one 256 bit vector of samples (MaxVoices is a whole number of batches)
+		static constexpr int lanes = 32 / static_cast<int> (sizeof(SampleType));
+		static_assert(MaxVoices % lanes == 0, "MaxVoices must be a multiple of the batch size");
+
+	private:
+
+		//per voice lanes
+		using Lanes = std::array<SampleType, MaxVoices>;
+
+		//one batch of lanes: state and coefficients of voices [first, first + lanes) copied to locals for the length of a process call, so
+		//every stage is a fixed trip count loop over arrays the compiler can keep in registers (no aliasing with delay memory or audio)
+		struct Batch
+		{
+			alignas(64) SampleType aa[4][lanes], reconstruction[4][lanes], filter[numFilterCoefficients][lanes];
+			alignas(64) SampleType envelope[lanes], chunkMax[lanes], thresholdIn[lanes], threshold[lanes], attackCoeff[lanes], releaseCoeff[lanes];
+			alignas(64) SampleType compressorMeanSquare[lanes], compressorLevel[lanes], compressorStep[lanes], expanderMeanSquare[lanes], expanderLevel[lanes], expanderStep[lanes];
+			alignas(64) SampleType companderCoeff[lanes], inverseReferenceSquared[lanes];
+			alignas(64) SampleType memoryFeedback[lanes], loopFeedback[lanes], wet[lanes], hissAmplitude[lanes], clockAmplitude[lanes];
+			alignas(64) int rate[lanes], table[lanes], chunkCounter[lanes], companderCounter[lanes];
+			alignas(64) bool analog[lanes], companderOn[lanes], noiseOn[lanes];
+			alignas(64) std::uint32_t noiseKey[lanes], noiseCounter[lanes], clockPhase[lanes], clockIncrement[lanes];
+		};
+
+		//copy voices [first, first + numVoices) into batch (toBatch) or the batch state back to the bank; lanes past numVoices keep the
+		//batch's zeroed state with every stage off, so they pass silence through, and are never copied back
+		template <bool ToBatch>
+		void exchange(Batch& batch, int first, int numVoices) noexcept
+		{
+			const auto move = [](auto& bank, auto& local)
+			{
+				if (ToBatch) local = bank;
+				else bank = local;
+			};
+			for (int v = 0; v < lanes; ++v)
+			{
+				if (v >= numVoices)
+					continue;
+				const int voice = first + v;
+				for (int i = 0; i < 4; ++i)
+				{
+					move(mAAState[i][voice], batch.aa[i][v]);
+					move(mReconstructionState[i][voice], batch.reconstruction[i][v]);
+				}
+				move(mEnvelope[voice], batch.envelope[v]);
+				move(mChunkMax[voice], batch.chunkMax[v]);
+				move(mThresholdIn[voice], batch.thresholdIn[v]);
+				move(mChunkCounter[voice], batch.chunkCounter[v]);
+				move(mCompressor.meanSquare[voice], batch.compressorMeanSquare[v]);
+				move(mCompressor.level[voice], batch.compressorLevel[v]);
+				move(mCompressor.step[voice], batch.compressorStep[v]);
+				move(mExpander.meanSquare[voice], batch.expanderMeanSquare[v]);
+				move(mExpander.level[voice], batch.expanderLevel[v]);
+				move(mExpander.step[voice], batch.expanderStep[v]);
+				move(mCompanderCounter[voice], batch.companderCounter[v]);
+				move(mNoiseCounter[voice], batch.noiseCounter[v]);
+				move(mClockPhase[voice], batch.clockPhase[v]);
+				if (ToBatch)
+				{
+					for (int i = 0; i < numFilterCoefficients; ++i)
+						batch.filter[i][v] = mFilter[i][voice];
+					batch.threshold[v] = mThreshold[voice];
+					batch.attackCoeff[v] = mAttackCoeff[voice];
+					batch.releaseCoeff[v] = mReleaseCoeff[voice];
+					batch.companderCoeff[v] = mCompanderCoeff[voice];
+					batch.inverseReferenceSquared[v] = mInverseReferenceSquared[voice];
+					batch.memoryFeedback[v] = mMemoryFeedback[voice];
+					batch.loopFeedback[v] = mLoopFeedback[voice];
+					batch.wet[v] = mWet[voice];
+					batch.hissAmplitude[v] = mHissAmplitude[voice];
+					batch.clockAmplitude[v] = mClockAmplitude[voice];
+					batch.analog[v] = mAnalog[voice];
+					batch.companderOn[v] = mCompanderOn[voice];
+					batch.noiseOn[v] = mNoiseOn[voice];
+					batch.rate[v] = mRate[voice];
+					batch.table[v] = mTable[voice] * (tableSize + 1);
+					batch.noiseKey[v] = mNoiseKey[voice];
+					batch.clockIncrement[v] = mClockIncrement[voice];
+				}
+			}
+		}
+
+		//run a batch of numVoices (<= lanes) voices starting at voice first over numSamples (lanes past numVoices still take part in the
+		//vector operations, but masked: silence in, every stage passed through, and neither their delay memory nor their state written)
+		void processBatch(SampleType* const* voices, int numVoices, int first, int numSamples) noexcept
+		{
+			Batch batch{};
+			exchange<true>(batch, first, numVoices);
+			const SampleType* tables = mTables[0].data();
+			SampleType* delay = mDelay + first * mDelayLength;
+			alignas(64) SampleType dry[lanes], write[lanes], delayed[lanes], wet[lanes], position[lanes], shaped[lanes];
+			alignas(64) int index[lanes], readPosition[lanes];
+
+			for (int i = 0; i < numSamples; ++i)
+			{
+				for (int v = 0; v < lanes; ++v)
+					dry[v] = (v < numVoices) ? voices[v][i] : SampleType(0);
+
+				//write path: anti-aliasing filter and dynamic waveshaper (analog voices), then the compressor below
+				for (int v = 0; v < lanes; ++v)
+					write[v] = dry[v];
+				processFilter(batch.aa, batch.filter, batch.analog, write);
+
+				//(lookupWaveshaper split into index, gather, and blend loops so each vectorises)
+				for (int v = 0; v < lanes; ++v)
+				{
+					const SampleType chunkMax = std::max(batch.chunkMax[v], std::abs(write[v]));
+					const SampleType coeff = (batch.thresholdIn[v] > batch.envelope[v]) ? batch.attackCoeff[v] : batch.releaseCoeff[v];
+					const SampleType envelope = coeff * batch.envelope[v] + (SampleType(1) - coeff) * batch.thresholdIn[v];
+					batch.chunkMax[v] = batch.analog[v] ? chunkMax : batch.chunkMax[v];
+					batch.envelope[v] = batch.analog[v] ? envelope : batch.envelope[v];
+					position[v] = (std::min(std::max(write[v], SampleType(-1)), SampleType(1)) + SampleType(1)) * SampleType(tableSize / 2);
+					index[v] = std::min(static_cast<int> (position[v]), tableSize - 1);
+				}
+				for (int v = 0; v < lanes; ++v)
+				{
+					const SampleType* table = tables + batch.table[v] + index[v];
+					shaped[v] = table[0] + (position[v] - SampleType(index[v])) * (table[1] - table[0]);
+				}
+				for (int v = 0; v < lanes; ++v)
+					write[v] = batch.analog[v] ? write[v] + batch.envelope[v] * (shaped[v] - write[v]) : write[v];
+				updateTargets(batch.compressorMeanSquare, batch.compressorLevel, batch.compressorStep, batch.inverseReferenceSquared, batch.companderOn, batch.companderCounter);
+				updateTargets(batch.expanderMeanSquare, batch.expanderLevel, batch.expanderStep, batch.inverseReferenceSquared, batch.companderOn, batch.companderCounter);
+
+				//delayed read (Rate 0, only without the compander, reads the sample about to be written)
+				for (int v = 0; v < lanes; ++v)
+				{
+					const int read = mWritePosition - batch.rate[v];
+					readPosition[v] = (read < 0) ? read + mDelayLength : read;
+				}
+				for (int v = 0; v < lanes; ++v)
+					delayed[v] = (readPosition[v] == mWritePosition) ? sanitise(write[v]) : delay[v * mDelayLength + readPosition[v]];
+
+				//wet path up to the reconstruction filter: hiss and clock bleed, expander
+				for (int v = 0; v < lanes; ++v)
+				{
+					const std::uint32_t hash = lowBias32(lowBias32(batch.noiseCounter[v] ^ batch.noiseKey[v]));
+					const SampleType hiss = batch.hissAmplitude[v] * (static_cast<SampleType> (static_cast<std::int32_t> (hash)) * static_cast<SampleType> (1.0 / 2147483648.0));
+					const std::uint32_t phase = batch.clockPhase[v];
+					const std::int32_t folded = static_cast<std::int32_t> ((phase ^ static_cast<std::uint32_t> (static_cast<std::int32_t> (phase) >> 31)) - 0x40000000u);
+					const SampleType clock = batch.clockAmplitude[v] * (static_cast<SampleType> (folded) * static_cast<SampleType> (1.0 / 1073741824.0));
+					wet[v] = batch.noiseOn[v] ? (delayed[v] + hiss) + clock : delayed[v];
+					batch.noiseCounter[v] += batch.noiseOn[v] ? 1u : 0u;
+					batch.clockPhase[v] = batch.noiseOn[v] ? phase + batch.clockIncrement[v] : phase;
+				}
+				processCompander<false>(batch.expanderMeanSquare, batch.expanderLevel, batch.expanderStep, batch.companderCoeff, batch.companderOn, wet);
+
+				//delay memory with feedback: a compander voice feeds the expanded signal back into its compressor and writes the compressed
+				//signal unclamped (see BBDChain), any other voice the delay memory itself after the (passed through) compressor
+				for (int v = 0; v < lanes; ++v)
+					write[v] = sanitise(write[v] + batch.loopFeedback[v] * wet[v]);
+				processCompander<true>(batch.compressorMeanSquare, batch.compressorLevel, batch.compressorStep, batch.companderCoeff, batch.companderOn, write);
+				for (int v = 0; v < lanes; ++v)
+					write[v] = batch.companderOn[v] ? write[v] : sanitise(write[v] + batch.memoryFeedback[v] * delayed[v]);
+				for (int v = 0; v < numVoices; ++v)
+					delay[v * mDelayLength + mWritePosition] = write[v];
+
+				//reconstruction filter
+				processFilter(batch.reconstruction, batch.filter, batch.analog, wet);
+				for (int v = 0; v < numVoices; ++v)
+					voices[v][i] = dry[v] + batch.wet[v] * wet[v];
+
+				//per voice counters advance only while their stage runs, as BBDChain's
+				for (int v = 0; v < lanes; ++v)
+				{
+					batch.chunkCounter[v] += batch.analog[v] ? 1 : 0;
+					if (batch.chunkCounter[v] == mChunkSize)
+					{
+						batch.chunkCounter[v] = 0;
+						batch.thresholdIn[v] = (batch.chunkMax[v] > batch.threshold[v]) ? SampleType(1) : SampleType(0);
+						batch.chunkMax[v] = SampleType(0);
+					}
+					batch.companderCounter[v] += batch.companderOn[v] ? 1 : 0;
+					if (batch.companderCounter[v] == controlInterval)
+						batch.companderCounter[v] = 0;
+				}
+				if (++mWritePosition == mDelayLength)
+					mWritePosition = 0;
+			}
+			exchange<false>(batch, first, numVoices);
+		}
+
+		//two transposed direct form II biquads over a batch, per voice coefficients (voices that are not on pass through with their state held)
+		static void processFilter(SampleType (&state)[4][lanes], const SampleType (&filter)[numFilterCoefficients][lanes], const bool* on, SampleType* data) noexcept
+		{
+			processSection(state[0], state[1], filter[0], filter[1], filter[2], filter[3], filter[4], on, data);
+			processSection(state[2], state[3], filter[5], filter[6], filter[7], filter[8], filter[9], on, data);
+		}
+
+		//one biquad section over a batch
+		static void processSection(SampleType* s1, SampleType* s2, const SampleType* b0, const SampleType* b1, const SampleType* b2, const SampleType* a1, const SampleType* a2, const bool* on, SampleType* data) noexcept
+		{
+			for (int v = 0; v < lanes; ++v)
+			{
+				const SampleType x = data[v];
+				const SampleType y = b0[v] * x + s1[v];
+				const SampleType next1 = b1[v] * x - a1[v] * y + s2[v];
+				const SampleType next2 = b2[v] * x - a2[v] * y;
+				s1[v] = on[v] ? next1 : s1[v];
+				s2[v] = on[v] ? next2 : s2[v];
+				data[v] = on[v] ? y : x;
+			}
+		}
+
+		//ramp the compander level of voices that are on and at the start of a control interval towards getCompanderLevel
+		static void updateTargets(const SampleType* meanSquare, const SampleType* level, SampleType* step, const SampleType* inverseReferenceSquared, const bool* on, const int* counter) noexcept
+		{
+			for (int v = 0; v < lanes; ++v)
+				if (on[v] && counter[v] == 0)
+					step[v] = (getCompanderLevel(meanSquare[v], inverseReferenceSquared[v]) - level[v]) * SampleType(1.0 / controlInterval);
+		}
+
+		//one half of the NE570 compander over a batch: the compressor divides by its level and detects its output, the expander
+		//detects its input and multiplies by its level (as BBDChain); voices that are not on pass through with their state held
+		template <bool Compress>
+		static void processCompander(SampleType* meanSquare, SampleType* level, const SampleType* step, const SampleType* coeff, const bool* on, SampleType* data) noexcept
+		{
+			for (int v = 0; v < lanes; ++v)
+			{
+				const SampleType x = data[v];
+				const SampleType l = level[v] + step[v];
+				const SampleType y = Compress ? x / l : x * l;
+				const SampleType detected = Compress ? y : x;
+				const SampleType ms = coeff[v] * meanSquare[v] + (SampleType(1) - coeff[v]) * detected * detected;
+				meanSquare[v] = on[v] ? ms : meanSquare[v];
+				level[v] = on[v] ? l : level[v];
+				data[v] = on[v] ? y : x;
+			}
+		}
+
+		//one half of the NE570 compander for every voice
+		struct CompanderLanes
+		{
+			alignas(64) Lanes meanSquare, level, step;
+
+			void reset() noexcept
+			{
+				meanSquare.fill(SampleType(0));
+				level.fill(SampleType(1));
+				step.fill(SampleType(0));
+			}
+		};
+
+		//target waveshaper tables followed by one morph slot per voice
+		std::array<std::array<SampleType, tableSize + 1>, numTargetWaveshapers + MaxVoices> mTables;
+
+		//state
+		SampleType* mDelay = nullptr;
+		int mDelayLength = 0, mWritePosition = 0;
+		alignas(64) std::array<Lanes, 4> mAAState{}, mReconstructionState{};
+		alignas(64) Lanes mEnvelope{}, mChunkMax{}, mThresholdIn{};
+		int mChunkSize = 441;
+		std::array<int, MaxVoices> mChunkCounter{}, mCompanderCounter{};
+		CompanderLanes mCompressor, mExpander;
+		alignas(64) std::array<std::uint32_t, MaxVoices> mNoiseCounter{}, mClockPhase{};
+
+		//per voice parameters
+		std::array<Parameters, MaxVoices> mParameters;
+		std::array<int, MaxVoices> mNoiseChannel{};
+		std::array<bool, MaxVoices> mHaveParameters{};
+		std::array<int, MaxVoices> mRate{};
+		alignas(64) std::array<Lanes, numFilterCoefficients> mFilter{};
+		alignas(64) Lanes mMemoryFeedback{}, mLoopFeedback{}, mWet{}, mThreshold{}, mAttackCoeff{}, mReleaseCoeff{};
+		alignas(64) Lanes mCompanderCoeff{}, mInverseReferenceSquared{}, mHissAmplitude{}, mClockAmplitude{};
+		std::array<bool, MaxVoices> mAnalog{}, mCompanderOn{}, mNoiseOn{};
+		std::array<int, MaxVoices> mTable{};
+		std::array<std::uint32_t, MaxVoices> mNoiseKey{}, mClockIncrement{};
+
+		//environment variables
+		double mSampleRate = 44100.0;
+	};
+}
@@ -10,62 +10,312 @@
 
 #include "DynamicWaveshaper.h"
 
-void DynamicWaveshaper::prepare(dsp::ProcessSpec spec)
+namespace
+{
+	//crossover section types
+	enum { identity = 0, lowPass, highPass, allPass };
+
+	//one Butterworth (Q = 1 / sqrt(2)) RBJ biquad of type at hz normalised by a0 (b0, b1, b2, a1, a2): two in cascade make a Linkwitz-Riley
+	//low or high pass, and their sum is the allpass, so a band that skips a split takes the allpass to stay in phase with the others
+	void designCrossoverSection(int type, double hz, double sampleRate, double* coefficients) noexcept
+	{
+		if (type == identity)
+		{
+			const double passThrough[5] = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+			std::copy(passThrough, passThrough + 5, coefficients);
+			return;
+		}
+		const double w0 = 2.0 * MathConstants<double>::pi * jmin(hz, sampleRate * 0.45) / sampleRate;
+		const double cosW0 = std::cos(w0), alpha = std::sin(w0) / MathConstants<double>::sqrt2;
+		const double a0 = 1.0 + alpha;
+		double b[3];
+		if (type == lowPass)
+		{
+			b[0] = b[2] = 0.5 * (1.0 - cosW0);
+			b[1] = 1.0 - cosW0;
+		}
+		else if (type == highPass)
+		{
+			b[0] = b[2] = 0.5 * (1.0 + cosW0);
+			b[1] = -(1.0 + cosW0);
+		}
+		else
+		{
+			b[0] = 1.0 - alpha;
+			b[1] = -2.0 * cosW0;
+			b[2] = 1.0 + alpha;
+		}
+		coefficients[0] = b[0] / a0;
+		coefficients[1] = b[1] / a0;
+		coefficients[2] = b[2] / a0;
+		coefficients[3] = -2.0 * cosW0 / a0;
+		coefficients[4] = (1.0 - alpha) / a0;
+	}
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::prepare(dsp::ProcessSpec spec)
 {
 	//get environment variables
 	mBlockSize = spec.maximumBlockSize;
+	mNumSamples = mBlockSize;
 	mNumChannels = spec.numChannels;
 	mSampleRate = spec.sampleRate;
 
-	//keep track of max value in chunks sampled at 100Hz
+	//keep track of max value in chunks sampled at 100Hz (restart envelope so renders are repeatable)
 	mChunkSize = spec.sampleRate / 100.0f;
+	mChunkCounter = 0;
 
 #if JUCE_USE_SIMD
-	//prepare for channel interleaving
-	mInterleaved = dsp::AudioBlock<dsp::SIMDRegister<float>>(interleavedBlockData, 1, mBlockSize);
-	mZero = dsp::AudioBlock<float>(zeroData, dsp::SIMDRegister<float>::size(), mBlockSize);
-	mZero.clear();
+	//prepare for channel interleaving (every channel in one register, the band channels in up to maxBands groups)
+	jassert(mNumChannels <= maxChannels);
+	mInterleaver.prepare(maxBands * SIMDInterleaver<SampleType>::lanes, mBlockSize);
+	mLastSample = 0;
+	mChunkMaxIn = 0;
+	mSideChainThreshIn = 0;
 #else
-	mChunkMaxIn = std::make_unique<float[]>(mNumChannels);
-	mSideChainThreshIn = std::make_unique<float[]>(mNumChannels);
-	mLastSample = std::make_unique<float[]>(mNumChannels); //set up zeroed y[n-1] array elements each channel to prepare for IIR envelope smoothing
+	mChunkMaxIn = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+	mSideChainThreshIn = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+	mLastSample = std::make_unique<SampleType[]>(maxBands * mNumChannels); //set up zeroed y[n-1] array elements each band channel to prepare for IIR envelope smoothing
 #endif	
 
-	//initialize waveshapers and side chain signal
-	mTargetWaveshapers.ensureStorageAllocated(4);
-	mTargetWaveshapers.add(std::make_unique<dsp::LookupTableTransform<float>>([](float x) {return x; }, -1.0f, 1.0f, 2)); //Linear
-	mTargetWaveshapers.add (std::make_unique<dsp::LookupTableTransform<float>>([](float x) {return x - (pow(x,2)/8.0f) - (pow(x,3)/16.0f) + 0.125f; }, -1.0f, 1.0f, 512)); //BBD waveshaper approxmiation
-	mTargetWaveshapers.add(std::make_unique<dsp::LookupTableTransform<float>>([this](float x) {return x + Decibels::decibelsToGain(-42.0f)*T_2(x) 
-		+ Decibels::decibelsToGain(-68.0f) * T_3(x) + Decibels::decibelsToGain(-84.0f) * T_4(x); }, -1.0f, 1.0f, 512)); //Chebyshev Harmonic Matching to 6AU6A Pentode with -90dB noise floor, harmonics boosted 6dB
-	mTargetWaveshapers.add(std::make_unique<dsp::LookupTableTransform<float>>([](float x) {return tanh(15 * x); }, -1.0f, 1.0f, 512)); //Smashed signal with boosted tanh
-	mTargetWaveshapers.minimiseStorageOverheads();
-	mSideChain.setSize(mNumChannels, mBlockSize);
+	//sliding window detectors span one chunk
+	mWindowScale = static_cast<SampleType> (1.0 / mChunkSize);
+#if JUCE_USE_SIMD
+	mWindow = dsp::AudioBlock<dsp::SIMDRegister<SampleType>>(mWindowData, 2 * maxBands, static_cast<size_t> (mChunkSize + 1));
+#else
+	mWindow.setSize(2 * maxBands * mNumChannels, mChunkSize + 1);
+	mPrefixMax = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+	mSum = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+	mCompensation = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+	mLevel = std::make_unique<SampleType[]>(maxBands * mNumChannels);
+#endif
+	resetWindow();
+
+	//initialize side chain signal and ADAA input history for every band channel, and build the target curves the waveshaper curves are
+	//blended from (built on first use, so here rather than on the audio thread)
+	mSideChain.setSize(maxBands * mNumChannels, mBlockSize);
+	mSideChain.clear();
+	mHistory.setSize(maxBands * mNumChannels, mBlockSize + 2);
+	mHistory.clear();
+	Curve::getTargets();
+
+	//band channels and crossover (laid out by the first update)
+	mBands.setSize(maxBands * mNumChannels, mBlockSize);
+	mInputPointers.calloc(static_cast<size_t> (jmax(1, mNumChannels)));
+#if JUCE_USE_SIMD
+	mCrossover = dsp::AudioBlock<dsp::SIMDRegister<SampleType>>(mCrossoverData, 3, static_cast<size_t> (maxBands * numCrossoverCoefficients));
+	const size_t numLanes = static_cast<size_t> (maxBands * SIMDInterleaver<SampleType>::lanes);
+	mLaneBandChannels.calloc(numLanes);
+	mLaneInputs.calloc(numLanes);
+	mBandOutputs.calloc(numLanes);
+	mSideChainOutputs.calloc(numLanes);
+	mDiscard.calloc(static_cast<size_t> (mBlockSize));
+#else
+	mCrossover = dsp::AudioBlock<SampleType>(mCrossoverData, 3, static_cast<size_t> (maxBands * jmax(1, mNumChannels) * numCrossoverCoefficients));
+#endif
+
+	//Lookahead delay sized for the longest Lookahead, on every band channel
+	dsp::ProcessSpec bandSpec = spec;
+	bandSpec.numChannels = static_cast<uint32> (maxBands * mNumChannels);
+	mLookahead.prepare(bandSpec, roundToInt(maxLookahead * 0.001f * static_cast<float> (mSampleRate)));
+
+	//key from the input until an owner sets an external key
+	mKeyPointers.calloc(static_cast<size_t> (jmax(1, mNumChannels)));
+	mExternalKey = false;
 
-	//initialize parameters
-	setAttack(50.0f);
-	setRelease(100.0f);
+	//Attack and Release coefficients depend on the sample rate (and a new sample rate never fades from the old choice)
+	mBufVersion = -1;
+	mFadePosition = mFadeLength = 0;
 }
 
-void DynamicWaveshaper::setTargetWaveshaper(int choice) noexcept
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setTargetWaveshaper(int choice) noexcept
 {
 	jassert(choice >= 0 && choice <= 3);
-	mTargetWaveshaper = choice;
+	mParameters.publish([choice](Parameters& parameters) { parameters.targetWaveshaper = choice; });
 }
 
-void DynamicWaveshaper::setThreshold(float dbThreshold) noexcept
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setCharacter(float character) noexcept
+{
+	jassert(character >= 0.0f && character <= 3.0f);
+	mParameters.publish([character](Parameters& parameters) { parameters.character = character; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setThreshold(float dbThreshold) noexcept
 {
 	jassert(dbThreshold <= 0.0f);
-	mThreshold = Decibels::decibelsToGain(dbThreshold);
+	mParameters.publish([dbThreshold](Parameters& parameters) { parameters.threshold = Decibels::decibelsToGain(dbThreshold); });
 }
 
-void DynamicWaveshaper::setAttack(float msAttack) noexcept
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setAttack(float msAttack) noexcept
 {
 	jassert(msAttack >= 0);
-	mAttackCoeff = exp(-1000 / (msAttack * mSampleRate));
+	mParameters.publish([msAttack](Parameters& parameters) { parameters.msAttack = msAttack; });
 }
 
-void DynamicWaveshaper::setRelease(float msRelease) noexcept
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setRelease(float msRelease) noexcept
 {
 	jassert(msRelease >= 0);
-	mReleaseCoeff = exp(-1000 / (msRelease * mSampleRate));
+	mParameters.publish([msRelease](Parameters& parameters) { parameters.msRelease = msRelease; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setCrossfade(float msCrossfade) noexcept
+{
+	jassert(msCrossfade >= 0.0f);
+	mParameters.publish([msCrossfade](Parameters& parameters) { parameters.msCrossfade = msCrossfade; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setAntialiasing(int order) noexcept
+{
+	jassert(order >= 0 && order <= 2);
+	mParameters.publish([order](Parameters& parameters) { parameters.antialiasing = order; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setDetector(int detector) noexcept
+{
+	jassert(detector >= chunkGate && detector <= rms);
+	mParameters.publish([detector](Parameters& parameters) { parameters.detector = detector; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setKnee(float dbKnee) noexcept
+{
+	jassert(dbKnee >= 0.0f);
+	mParameters.publish([dbKnee](Parameters& parameters) { parameters.knee = dbKnee; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setStereoLink(bool onOffStereoLink) noexcept
+{
+	mParameters.publish([onOffStereoLink](Parameters& parameters) { parameters.stereoLink = onOffStereoLink; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setLookahead(float msLookahead) noexcept
+{
+	jassert(msLookahead >= 0.0f && msLookahead <= maxLookahead);
+	mParameters.publish([msLookahead](Parameters& parameters) { parameters.msLookahead = jlimit(0.0f, maxLookahead, msLookahead); });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setBands(int numBands) noexcept
+{
+	jassert(numBands >= 1 && numBands <= maxBands);
+	mParameters.publish([numBands](Parameters& parameters) { parameters.bands = jlimit(1, maxBands, numBands); });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setLowCrossover(float hzLowCrossover) noexcept
+{
+	jassert(hzLowCrossover > 0.0f);
+	mParameters.publish([hzLowCrossover](Parameters& parameters) { parameters.hzLowCrossover = hzLowCrossover; });
 }
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setHighCrossover(float hzHighCrossover) noexcept
+{
+	jassert(hzHighCrossover > 0.0f);
+	mParameters.publish([hzHighCrossover](Parameters& parameters) { parameters.hzHighCrossover = hzHighCrossover; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setLowDrive(int percentLowDrive) noexcept
+{
+	jassert(percentLowDrive >= 0 && percentLowDrive <= 100);
+	mParameters.publish([percentLowDrive](Parameters& parameters) { parameters.lowDrive = static_cast<float> (percentLowDrive) / 100.0f; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::setHighDrive(int percentHighDrive) noexcept
+{
+	jassert(percentHighDrive >= 0 && percentHighDrive <= 100);
+	mParameters.publish([percentHighDrive](Parameters& parameters) { parameters.highDrive = static_cast<float> (percentHighDrive) / 100.0f; });
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::prepareBands() noexcept
+{
+	mNumBandChannels = mBufBands * mNumChannels;
+#if JUCE_USE_SIMD
+	//pack whole bands into groups: a stereo pair of 3 bands takes 2 groups of 4 float lanes, a mono 3 bands one group
+	const int lanes = SIMDInterleaver<SampleType>::lanes;
+	const int bandsPerGroup = lanes / mNumChannels;
+	mNumGroups = (mBufBands + bandsPerGroup - 1) / bandsPerGroup;
+	for (int group = 0; group < maxBands; ++group)
+	{
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			const int band = group * bandsPerGroup + lane / mNumChannels;
+			const bool used = lane < bandsPerGroup * mNumChannels && band < mBufBands;
+			const int bandChannel = used ? band * mNumChannels + lane % mNumChannels : -1;
+			mLaneBandChannels[group * lanes + lane] = bandChannel;
+			mBandOutputs[group * lanes + lane] = used ? mBands.getWritePointer(bandChannel) : mDiscard.getData();
+			mSideChainOutputs[group * lanes + lane] = used ? mSideChain.getWritePointer(bandChannel) : mDiscard.getData();
+		}
+	}
+	mLastSample = mChunkMaxIn = mSideChainThreshIn = 0;
+	for (auto& state : mGroupStates)
+		state = GroupState();
+#else
+	for (int channel = 0; channel < maxBands * mNumChannels; ++channel)
+		mLastSample[channel] = mChunkMaxIn[channel] = mSideChainThreshIn[channel] = 0;
+#endif
+
+	//a new layout carries nothing over: filters, envelopes, windows, ADAA history, and the Lookahead delay restart from silence
+	mCrossover.clear();
+	resetWindow();
+	mSideChain.clear();
+	mHistory.clear();
+	mLookahead.reset();
+}
+
+template <typename SampleType>
+void DynamicWaveshaper<SampleType>::updateCrossover(float hzLowCrossover, float hzHighCrossover) noexcept
+{
+	if (mBufBands == 1)
+		return;
+
+	//2 bands are one Linkwitz-Riley split at Low Crossover; 3 bands split the upper band again at High Crossover and pass the low band
+	//through the matching allpass, so all three carry the phase of both splits and sum to an allpass
+	static constexpr int sections[2][maxBands][numCrossoverSections] = {
+		{ { lowPass, lowPass, identity, identity }, { highPass, highPass, identity, identity }, { identity, identity, identity, identity } },
+		{ { lowPass, lowPass, allPass, identity }, { highPass, highPass, lowPass, lowPass }, { highPass, highPass, highPass, highPass } } };
+	const auto& types = sections[mBufBands - 2];
+	mNumCrossoverSections = (mBufBands == 2) ? 2 : 4;
+	const double hz[numCrossoverSections] = { hzLowCrossover, hzLowCrossover, jmax(hzLowCrossover, hzHighCrossover), jmax(hzLowCrossover, hzHighCrossover) };
+	double designed[maxBands + 1][numCrossoverCoefficients];
+	for (int band = 0; band <= maxBands; ++band)
+		for (int section = 0; section < numCrossoverSections; ++section)
+			designCrossoverSection(band < maxBands ? types[band][section] : identity, hz[section], static_cast<double> (mSampleRate), designed[band] + section * 5);
+
+#if JUCE_USE_SIMD
+	//every lane takes its band's coefficients (lanes without a band pass through)
+	const int lanes = SIMDInterleaver<SampleType>::lanes;
+	for (int group = 0; group < mNumGroups; ++group)
+	{
+		auto* coefficients = mCrossover.getChannelPointer(0) + group * numCrossoverCoefficients;
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			const int bandChannel = mLaneBandChannels[group * lanes + lane];
+			const double* c = designed[bandChannel >= 0 ? bandChannel / mNumChannels : maxBands];
+			for (int i = 0; i < numCrossoverCoefficients; ++i)
+				coefficients[i].set(static_cast<size_t> (lane), static_cast<SampleType> (c[i]));
+		}
+	}
+#else
+	for (int band = 0; band < mBufBands; ++band)
+		for (int i = 0; i < numCrossoverCoefficients; ++i)
+			mCrossover.getChannelPointer(0)[band * numCrossoverCoefficients + i] = static_cast<SampleType> (designed[band][i]);
+#endif
+}
+
+template class DynamicWaveshaper<float>;
+template class DynamicWaveshaper<double>;
@@ -10,12 +10,38 @@
 
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "SIMDInterleaver.h"
+#include "DlayCore.h"
+#include "ParameterSnapshot.h"
+#include "ShortDelay.h"
 
+template <typename SampleType>
 class DynamicWaveshaper
 {
 public:
 
+	//side chain detectors: the legacy hard gate on 10ms chunk maxima, or a sliding 10ms window's peak or RMS updated every sample
+	enum Detector
+	{
+		chunkGate = 0,
+		peak,
+		rms
+	};
+
+	//longest Lookahead in ms
+	static constexpr float maxLookahead = 10.0f;
+
+	//most Bands
+	static constexpr int maxBands = 3;
+
+	//most channels: every channel rides one lane of a single SIMD register, so double precision (fewest lanes) bounds the bus layouts
+#if JUCE_USE_SIMD
+	static constexpr int maxChannels = SIMDInterleaver<double>::lanes;
+#else
+	static constexpr int maxChannels = std::numeric_limits<int>::max();
+#endif
+
 	// Essential Methods
 	//==============================================================================
 
@@ -26,28 +52,45 @@ public:
 	template <typename ProcessContext>
 	void process(const ProcessContext& context) noexcept
 	{
-		//get I/O blocks and handle bypass
+		//get I/O blocks of up to the prepared block size and handle bypass (which keeps the Lookahead delay, so latency doesn't change)
 		const auto& inputBlock = context.getInputBlock();
 		auto& outputBlock = context.getOutputBlock();
+		mNumSamples = static_cast<int> (outputBlock.getNumSamples());
+		jassert(mNumSamples <= mBlockSize);
+		if (mNumSamples == 0)
+			return;
 		if (context.isBypassed)
 		{
 			if (context.usesSeparateInputAndOutputBlocks())
 				outputBlock.copyFrom(inputBlock);
+			updateBufParams();
+			mLookahead.process(outputBlock);
 		}
 		//process
 		else
 		{
 			updateBufParams();
-			updateSideChain(inputBlock);
-			//apply amount of waveshaping proportional to sidechain signal
-			for (int channel = 0; channel < mNumChannels; ++channel) {
-				for (int i = 0; i < mBlockSize; ++i) {
-					outputBlock.getChannelPointer(channel)[i] = std::lerp(
-						inputBlock.getChannelPointer(channel)[i],
-						mTargetWaveshapers.getUnchecked(mBufTargetWaveshaper)->processSampleUnchecked(inputBlock.getChannelPointer(channel)[i]),
-						mSideChain.getSample(channel, i)
-					);
-				}
+			if (mBufBands > 1)
+			{
+				processBands(inputBlock, outputBlock);
+				return;
+			}
+			if (mExternalKey)
+				updateSideChain(dsp::AudioBlock<const SampleType>(mKeyPointers.getData(), static_cast<size_t> (mNumChannels), static_cast<size_t> (mNumSamples)));
+			else
+				updateSideChain(inputBlock);
+
+			//with Lookahead the side chain runs ahead of the audio it shapes
+			if (mLookahead.getDelay() > 0)
+			{
+				if (context.usesSeparateInputAndOutputBlocks())
+					outputBlock.copyFrom(inputBlock);
+				mLookahead.process(outputBlock);
+				shape(outputBlock, outputBlock);
+			}
+			else
+			{
+				shape(inputBlock, outputBlock);
 			}
 		}
 	}
@@ -67,163 +110,734 @@ public:
 	//set Release using ms value >= 0.0f
 	void setRelease(float msRelease) noexcept;
 
+	//set Character using a value in [0, 3]: morphs from the Target Waveshaper towards the next ones (Linear, BBD, Tube, Smashed), clamped at Smashed
+	void setCharacter(float character) noexcept;
+
+	//set the transition time of waveshaper position jumps (Target Waveshaper changes, Character jumps) using ms value >= 0.0f (0 switches instantly)
+	void setCrossfade(float msCrossfade) noexcept;
+
+	//set Antialiasing using an int in the range [0,2]: plain table lookup, or first or second order antiderivative anti-aliasing (ADAA),
+	//which delays the write path by half a sample or one sample; that delay is not reported as latency since only the echoes carry it (they
+	//arrive at most a sample late, like a Rate a fraction of a sample longer) while the dry signal is untouched, and a fractional latency
+	//could not be reported anyway
+	void setAntialiasing(int order) noexcept;
+
+	//set Detector using an int in the range [0,2] (see Detector)
+	void setDetector(int detector) noexcept;
+
+	//set Knee using dB value >= 0.0f: the side chain target rises smoothly from 0 to 1 over Knee dB centred on Threshold (0 is a hard
+	//threshold) for the sliding detectors: Peak knees the amplitude, RMS the mean square; Chunk Gate stays hard
+	void setKnee(float dbKnee) noexcept;
+
+	//set Stereo Link On/Off: every channel follows the loudest channel's detector instead of its own
+	void setStereoLink(bool onOffStereoLink) noexcept;
+
+	//set Lookahead using ms value in [0, maxLookahead]: delays the shaped audio (not the side chain) by roundToInt(ms * 0.001f * sample rate)
+	//samples, so the envelope opens before a transient arrives; the owner compensates the latency (see getLookaheadSamples)
+	void setLookahead(float msLookahead) noexcept;
+
+	//Lookahead delay of the last processed block in samples (audio thread only)
+	int getLookaheadSamples() const noexcept { return mLookahead.getDelay(); }
+
+	//set Bands using an int in the range [1, maxBands]: 1 shapes the full band; 2 or 3 split the input with Linkwitz-Riley crossovers
+	//(24dB/oct) and give every band its own envelope and shaper, the bands summing back to an allpass of the input where nothing is shaped
+	void setBands(int numBands) noexcept;
+
+	//set Low Crossover and High Crossover using Hz values > 0.0f: 2 bands split at Low Crossover, 3 at both (kept below 0.45 * sample rate)
+	void setLowCrossover(float hzLowCrossover) noexcept;
+	void setHighCrossover(float hzHighCrossover) noexcept;
+
+	//set Low Drive and High Drive using percent values in [0, 100]: scale the side chain of the lowest and highest band (the mid band
+	//always takes the whole side chain), so the drive can be kept to the mids
+	void setLowDrive(int percentLowDrive) noexcept;
+	void setHighDrive(int percentHighDrive) noexcept;
+
+	//key the side chain of following processes from numChannels external channels as long as the processed block, read in place (channel c
+	//follows key channel c, or the last one when there are fewer), or from the input block again when numChannels is 0 (audio thread;
+	//the channels must stay valid until the next call or process, so owners set it before every process)
+	void setExternalKey(const SampleType* const* channels, int numChannels) noexcept
+	{
+		mExternalKey = numChannels > 0;
+		for (int channel = 0; channel < mNumChannels && mExternalKey; ++channel)
+			mKeyPointers[channel] = channels[jmin(channel, numChannels - 1)];
+	}
+
+	// Visualisation
+	//==============================================================================
+
+	//exact (non-tabulated) waveshaper curve at a continuous position (see getWaveshaperPosition), safe to evaluate on any thread
+	static SampleType applyWaveshaper(float position, SampleType x) noexcept { return dlay::applyMorphedWaveshaper(position, x); }
+
+	//get current waveshaper position in [0, 3]: Target Waveshaper plus Character (any thread but the audio thread)
+	float getWaveshaperPosition() const noexcept { return mParameters.getLatest().getPosition(); }
+
+	//side chain envelope of the last processed block (audio thread only); with Bands, band b of channel c is channel b * channels + c
+	const AudioBuffer<SampleType>& getSideChain() const noexcept { return mSideChain; }
+
+	//Bands of the last processed block (audio thread only)
+	int getNumBands() const noexcept { return mBufBands; }
+
 private:
 
+	//microbenchmarks time updateSideChain on its own
+	friend class Benchmarks;
+
 	//save an audio block's signal envelope to a side chain buffer using Threshold, Attack, and Release parameters(call once per process after updateBufParams)
-	void updateSideChain(const dsp::AudioBlock<const float>& inputBlock) noexcept
+	void updateSideChain(const dsp::AudioBlock<const SampleType>& inputBlock) noexcept
 	{
 #if JUCE_USE_SIMD
-		//=======================interleave inputBlock for processing
-		auto* inout = mChannelPointers.getData();
-		for (size_t channel = 0; channel < dsp::SIMDRegister<float>::size(); ++channel)
-			inout[channel] = (channel < inputBlock.getNumChannels()) ? const_cast<float*> (inputBlock.getChannelPointer(channel)) : mZero.getChannelPointer(channel); //fill extra channels with zero data
-		AudioDataConverters::interleaveSamples(inout, reinterpret_cast<float*> (mInterleaved.getChannelPointer(0)), //make sure to set float granularity
-			mBlockSize, static_cast<int> (dsp::SIMDRegister<float>::size()));
-		//=======================process mInterleaved data
-		//process first samples
-		mChunkMaxIn = dsp::SIMDRegister<float>::max(dsp::SIMDRegister<float>::abs(mInterleaved.getChannelPointer(0)[0]), mChunkMaxIn); //get max before processing
-		auto iirMask = dsp::SIMDRegister<float>::greaterThan(mSideChainThreshIn, mLastSample);
-		mInterleaved.getChannelPointer(0)[0] = ((mBufAttackCoeff * mLastSample + ((ONE - mBufAttackCoeff) * mSideChainThreshIn)) & iirMask) 
-			+ ((mBufReleaseCoeff*mLastSample + ((ONE - mBufReleaseCoeff) * mSideChainThreshIn)) & (~iirMask));
-		if (++mChunkCounter == mChunkSize)
-		{
-			mChunkCounter = 0;
-			auto maxMask = dsp::SIMDRegister<float>::greaterThan(mChunkMaxIn, mBufThreshold);
-			mSideChainThreshIn = (ONE & maxMask) + (ZERO & (~maxMask));
-			mChunkMaxIn = 0.0f;
-		}
-		for (int i = 1; i < mBlockSize; ++i) {
-			mChunkMaxIn = dsp::SIMDRegister<float>::max(dsp::SIMDRegister<float>::abs(mInterleaved.getChannelPointer(0)[i]), mChunkMaxIn);
-			auto iirLoopMask = dsp::SIMDRegister<float>::greaterThan(mSideChainThreshIn, mInterleaved.getChannelPointer(0)[i-1]);
-			mInterleaved.getChannelPointer(0)[i] = ((mBufAttackCoeff * mInterleaved.getChannelPointer(0)[i - 1] + ((ONE - mBufAttackCoeff) * mSideChainThreshIn)) & iirLoopMask) 
-				+ ((mBufReleaseCoeff * mInterleaved.getChannelPointer(0)[i - 1] + ((ONE - mBufReleaseCoeff) * mSideChainThreshIn)) & (~iirLoopMask));
+		//=======================interleave inputBlock for processing (extra lanes read zeros)
+		auto* interleaved = mInterleaver.interleave(0, inputBlock);
+		//=======================process interleaved data
+		detect(interleaved, 0);
+		//=======================deinterleave
+		mInterleaver.deinterleave(0, mSideChain.getArrayOfWritePointers(), static_cast<int> (inputBlock.getNumChannels()), mNumSamples);
+#else
+		if (mBufDetector == peak)
+			updateSlidingSideChain<peak>(inputBlock);
+		else if (mBufDetector == rms)
+			updateSlidingSideChain<rms>(inputBlock);
+		else
+		{
+			//process first samples
+			for (int channel = 0; channel < mNumBandChannels; ++channel)
+			{
+				//use step response of a one pole low pass filter (IIR) to apply attack and release parameters to binary side chain
+				if (mSideChainThreshIn[channel] > mLastSample[channel]) {	
+					mSideChain.getWritePointer(channel)[0] = mBufAttackCoeff * mLastSample[channel] + ((1 - mBufAttackCoeff) * mSideChainThreshIn[channel]);
+				}
+				else {
+					mSideChain.getWritePointer(channel)[0] = mBufReleaseCoeff * mLastSample[channel] + ((1 - mBufReleaseCoeff) * mSideChainThreshIn[channel]);
+				}
+				//update max value in chunk
+				if (abs(inputBlock.getChannelPointer(channel)[0]) > mChunkMaxIn[channel])
+					mChunkMaxIn[channel] = abs(inputBlock.getChannelPointer(channel)[0]);
+			}
+			//threshold max value and reset for next chunk
 			if (++mChunkCounter == mChunkSize)
 			{
 				mChunkCounter = 0;
-				auto maxMask = dsp::SIMDRegister<float>::greaterThan(mChunkMaxIn, mBufThreshold);
-				mSideChainThreshIn = (ONE & maxMask) + (ZERO & (~maxMask));
-				mChunkMaxIn = 0.0f;
+				for (int channel = 0; channel < mNumBandChannels; ++channel)
+				{
+					if (mChunkMaxIn[channel] > mBufThreshold) { mSideChainThreshIn[channel] = 1.0f; }
+					else { mSideChainThreshIn[channel] = 0.0f; }
+					mChunkMaxIn[channel] = 0.0f;
+				}
+			}
+			//process rest of samples
+			for (int i = 1; i < mNumSamples; ++i)
+			{
+				for (int channel = 0; channel < mNumBandChannels; ++channel)
+				{
+					if (mSideChainThreshIn[channel] > mSideChain.getWritePointer(channel)[i-1]) {
+						//use step response of a one pole low pass filter (IIR) to apply attack and release parameters to binary side chain
+						mSideChain.getWritePointer(channel)[i] = mBufAttackCoeff * mSideChain.getWritePointer(channel)[i - 1] + ((1 - mBufAttackCoeff) * mSideChainThreshIn[channel]);
+					}
+					else {
+						mSideChain.getWritePointer(channel)[i] = mBufReleaseCoeff * mSideChain.getWritePointer(channel)[i - 1] + ((1 - mBufReleaseCoeff)* mSideChainThreshIn[channel]);
+					}
+					//update max value in chunk
+					if (abs(inputBlock.getChannelPointer(channel)[i]) > mChunkMaxIn[channel])
+						mChunkMaxIn[channel] = abs(inputBlock.getChannelPointer(channel)[i]);
+				}
+				//threshold max value and reset for next chunk
+				if (++mChunkCounter == mChunkSize)
+				{
+					mChunkCounter = 0;
+					for (int channel = 0; channel < mNumBandChannels; ++channel)
+					{
+						if (mChunkMaxIn[channel] > mBufThreshold) { mSideChainThreshIn[channel] = 1.0f; }
+						else { mSideChainThreshIn[channel] = 0.0f; }
+						mChunkMaxIn[channel] = 0.0f;
+					}
+				}
 			}
 		}
-		mLastSample = mInterleaved.getChannelPointer(0)[mBlockSize - 1];
-		//=======================deinterleave
-		for (size_t channel = 0; channel < inputBlock.getNumChannels(); ++channel)
-			inout[channel] = mSideChain.getWritePointer(channel);
-		AudioDataConverters::deinterleaveSamples(reinterpret_cast<float*> (mInterleaved.getChannelPointer(0)),
-				const_cast<float**> (inout), mBlockSize, static_cast<int> (dsp::SIMDRegister<float>::size()));
-#else
-		//process first samples
-		for (int channel = 0; channel < mNumChannels; ++channel)
+		//save last sample
+		for (int channel = 0; channel < mNumBandChannels; ++channel)
 		{
-			//use step response of a one pole low pass filter (IIR) to apply attack and release parameters to binary side chain
-			if (mSideChainThreshIn[channel] > mLastSample[channel]) {	
-				mSideChain.getWritePointer(channel)[0] = mBufAttackCoeff * mLastSample[channel] + ((1 - mBufAttackCoeff) * mSideChainThreshIn[channel]);
+			mLastSample[channel] = mSideChain.getWritePointer(channel)[mNumSamples-1];
+		}
+#endif
+	}
+
+#if JUCE_USE_SIMD
+	//run the detector over one interleaved group of lanes in place (group 0's state is in the members, see swapGroupState)
+	void detect(dsp::SIMDRegister<SampleType>* interleaved, int group) noexcept
+	{
+		if (mBufDetector == peak)
+			updateSlidingSideChain<peak>(interleaved, group);
+		else if (mBufDetector == rms)
+			updateSlidingSideChain<rms>(interleaved, group);
+		else
+		{
+			//process first samples
+			mChunkMaxIn = dsp::SIMDRegister<SampleType>::max(dsp::SIMDRegister<SampleType>::abs(interleaved[0]), mChunkMaxIn); //get max before processing
+			auto iirMask = dsp::SIMDRegister<SampleType>::greaterThan(mSideChainThreshIn, mLastSample);
+			interleaved[0] = ((mBufAttackCoeff * mLastSample + ((ONE - mBufAttackCoeff) * mSideChainThreshIn)) & iirMask) 
+				+ ((mBufReleaseCoeff*mLastSample + ((ONE - mBufReleaseCoeff) * mSideChainThreshIn)) & (~iirMask));
+			if (++mChunkCounter == mChunkSize)
+			{
+				mChunkCounter = 0;
+				auto maxMask = dsp::SIMDRegister<SampleType>::greaterThan(mChunkMaxIn, mBufThreshold);
+				mSideChainThreshIn = (ONE & maxMask) + (ZERO & (~maxMask));
+				mChunkMaxIn = 0.0f;
 			}
-			else {
-				mSideChain.getWritePointer(channel)[0] = mBufReleaseCoeff * mLastSample[channel] + ((1 - mBufReleaseCoeff) * mSideChainThreshIn[channel]);
+			for (int i = 1; i < mNumSamples; ++i) {
+				mChunkMaxIn = dsp::SIMDRegister<SampleType>::max(dsp::SIMDRegister<SampleType>::abs(interleaved[i]), mChunkMaxIn);
+				auto iirLoopMask = dsp::SIMDRegister<SampleType>::greaterThan(mSideChainThreshIn, interleaved[i-1]);
+				interleaved[i] = ((mBufAttackCoeff * interleaved[i - 1] + ((ONE - mBufAttackCoeff) * mSideChainThreshIn)) & iirLoopMask) 
+					+ ((mBufReleaseCoeff * interleaved[i - 1] + ((ONE - mBufReleaseCoeff) * mSideChainThreshIn)) & (~iirLoopMask));
+				if (++mChunkCounter == mChunkSize)
+				{
+					mChunkCounter = 0;
+					auto maxMask = dsp::SIMDRegister<SampleType>::greaterThan(mChunkMaxIn, mBufThreshold);
+					mSideChainThreshIn = (ONE & maxMask) + (ZERO & (~maxMask));
+					mChunkMaxIn = 0.0f;
+				}
 			}
-			//update max value in chunk
-			if (abs(inputBlock.getChannelPointer(channel)[0]) > mChunkMaxIn[channel])
-				mChunkMaxIn[channel] = abs(inputBlock.getChannelPointer(channel)[0]);
 		}
-		//threshold max value and reset for next chunk
-		if (++mChunkCounter == mChunkSize)
+		mLastSample = interleaved[mNumSamples - 1];
+	}
+
+	//sliding window detector over an interleaved group (its own window and suffix), writing the smoothed side chain in place: Peak is the van Herk/Gil-Werman running maximum (each chunk's suffix maxima are built once it ends, so a window ending at
+	//position j of the current chunk is the suffix of the last chunk from j + 1 joined with the prefix of this one), which costs O(1) per
+	//sample and never branches on a channel's data, unlike a monotonic deque; RMS keeps a compensated (Kahan) running sum of squares,
+	//summed afresh from the window at each chunk's end (also O(1) per sample) so rounding never accumulates past one chunk
+	template <int Mode>
+	void updateSlidingSideChain(dsp::SIMDRegister<SampleType>* interleaved, int group) noexcept
+	{
+		using Vec = dsp::SIMDRegister<SampleType>;
+		Vec* window = mWindow.getChannelPointer(static_cast<size_t> (2 * group));
+		Vec* suffix = mWindow.getChannelPointer(static_cast<size_t> (2 * group + 1));
+		Vec envelope = mLastSample;
+		for (int i = 0; i < mNumSamples; ++i)
 		{
-			mChunkCounter = 0;
-			for (int channel = 0; channel < mNumChannels; ++channel)
+			Vec level;
+			if (Mode == peak)
+			{
+				const Vec x = Vec::abs(interleaved[i]);
+				window[mChunkCounter] = x;
+				mPrefixMax = Vec::max(mPrefixMax, x);
+				level = Vec::max(suffix[mChunkCounter + 1], mPrefixMax);
+			}
+			else
+			{
+				const Vec x = interleaved[i] * interleaved[i];
+				const Vec y = (x - window[mChunkCounter]) - mCompensation;
+				const Vec sum = mSum + y;
+				mCompensation = (sum - mSum) - y;
+				mSum = sum;
+				window[mChunkCounter] = x;
+				level = Vec::max(mSum, ZERO) * mWindowScale;
+			}
+			if (mBufStereoLink)
+			{
+				//the loudest channel of every band (a band's channels are mNumChannels neighbouring lanes)
+				for (size_t first = 0; first < Vec::size(); first += static_cast<size_t> (mNumChannels))
+				{
+					const size_t last = jmin(Vec::size(), first + static_cast<size_t> (mNumChannels));
+					SampleType loudest = 0;
+					for (size_t lane = first; lane < last; ++lane)
+						loudest = jmax(loudest, level.get(lane));
+					for (size_t lane = first; lane < last; ++lane)
+						level.set(lane, loudest);
+				}
+			}
+
+			//soft knee target, then the same attack/release smoothing as the chunk gate
+			const Vec t = Vec::min(ONE, Vec::max(ZERO, (level - mBufKneeStart) * mBufKneeScale));
+			const Vec target = t * t * (THREE - TWO * t);
+			const auto iirMask = Vec::greaterThan(target, envelope);
+			envelope = ((mBufAttackCoeff * envelope + (ONE - mBufAttackCoeff) * target) & iirMask)
+				+ ((mBufReleaseCoeff * envelope + (ONE - mBufReleaseCoeff) * target) & (~iirMask));
+			interleaved[i] = envelope;
+
+			if (++mChunkCounter == mChunkSize)
 			{
-				if (mChunkMaxIn[channel] > mBufThreshold) { mSideChainThreshIn[channel] = 1.0f; }
-				else { mSideChainThreshIn[channel] = 0.0f; }
-				mChunkMaxIn[channel] = 0.0f;
+				mChunkCounter = 0;
+				if (Mode == peak)
+				{
+					for (int k = mChunkSize - 1; k >= 0; --k)
+						suffix[k] = Vec::max(window[k], suffix[k + 1]);
+					mPrefixMax = ZERO;
+				}
+				else
+				{
+					mSum = mCompensation = ZERO;
+					for (int k = 0; k < mChunkSize; ++k)
+						mSum += window[k];
+				}
 			}
 		}
-		//process rest of samples
-		for (int i = 1; i < mBlockSize; ++i)
+	}
+#else
+	//sliding window detector, one channel at a time per sample so Stereo Link can take each band's loudest channel (see the SIMD version)
+	template <int Mode>
+	void updateSlidingSideChain(const dsp::AudioBlock<const SampleType>& inputBlock) noexcept
+	{
+		for (int i = 0; i < mNumSamples; ++i)
 		{
-			for (int channel = 0; channel < mNumChannels; ++channel)
+			SampleType loudest[maxBands] = {};
+			for (int channel = 0; channel < mNumBandChannels; ++channel)
 			{
-				if (mSideChainThreshIn[channel] > mSideChain.getWritePointer(channel)[i-1]) {
-					//use step response of a one pole low pass filter (IIR) to apply attack and release parameters to binary side chain
-					mSideChain.getWritePointer(channel)[i] = mBufAttackCoeff * mSideChain.getWritePointer(channel)[i - 1] + ((1 - mBufAttackCoeff) * mSideChainThreshIn[channel]);
+				SampleType* window = mWindow.getWritePointer(2 * channel);
+				const SampleType* suffix = mWindow.getReadPointer(2 * channel + 1);
+				const SampleType in = inputBlock.getChannelPointer(channel)[i];
+				if (Mode == peak)
+				{
+					window[mChunkCounter] = abs(in);
+					mPrefixMax[channel] = jmax(mPrefixMax[channel], abs(in));
+					mLevel[channel] = jmax(suffix[mChunkCounter + 1], mPrefixMax[channel]);
 				}
-				else {
-					mSideChain.getWritePointer(channel)[i] = mBufReleaseCoeff * mSideChain.getWritePointer(channel)[i - 1]((1 - mBufReleaseCoeff)* mSideChainThreshIn[channel]);
+				else
+				{
+					const SampleType y = (in * in - window[mChunkCounter]) - mCompensation[channel];
+					const SampleType sum = mSum[channel] + y;
+					mCompensation[channel] = (sum - mSum[channel]) - y;
+					mSum[channel] = sum;
+					window[mChunkCounter] = in * in;
+					mLevel[channel] = jmax(mSum[channel], SampleType(0)) * mWindowScale;
 				}
-				//update max value in chunk
-				if (abs(inputBlock.getChannelPointer(channel)[i]) > mChunkMaxIn[channel])
-					mChunkMaxIn[channel] = abs(inputBlock.getChannelPointer(channel)[i]);
+				loudest[channel / mNumChannels] = jmax(loudest[channel / mNumChannels], mLevel[channel]);
+			}
+			for (int channel = 0; channel < mNumBandChannels; ++channel)
+			{
+				const SampleType level = mBufStereoLink ? loudest[channel / mNumChannels] : mLevel[channel];
+				const SampleType t = jlimit(SampleType(0), SampleType(1), (level - mBufKneeStart) * mBufKneeScale);
+				const SampleType target = t * t * (3 - 2 * t);
+				const SampleType coeff = (target > mLastSample[channel]) ? mBufAttackCoeff : mBufReleaseCoeff;
+				mLastSample[channel] = coeff * mLastSample[channel] + (1 - coeff) * target;
+				mSideChain.getWritePointer(channel)[i] = mLastSample[channel];
 			}
-			//threshold max value and reset for next chunk
 			if (++mChunkCounter == mChunkSize)
 			{
 				mChunkCounter = 0;
-				for (int channel = 0; channel < mNumChannels; ++channel)
+				if (Mode == peak)
 				{
-					if (mChunkMaxIn[channel] > mBufThreshold) { mSideChainThreshIn[channel] = 1.0f; }
-					else { mSideChainThreshIn[channel] = 0.0f; }
-					mChunkMaxIn[channel] = 0.0f;
+					for (int channel = 0; channel < mNumBandChannels; ++channel)
+					{
+						const SampleType* window = mWindow.getReadPointer(2 * channel);
+						SampleType* suffix = mWindow.getWritePointer(2 * channel + 1);
+						for (int k = mChunkSize - 1; k >= 0; --k)
+							suffix[k] = jmax(window[k], suffix[k + 1]);
+						mPrefixMax[channel] = 0;
+					}
+				}
+				else
+				{
+					for (int channel = 0; channel < mNumBandChannels; ++channel)
+					{
+						const SampleType* window = mWindow.getReadPointer(2 * channel);
+						mSum[channel] = mCompensation[channel] = 0;
+						for (int k = 0; k < mChunkSize; ++k)
+							mSum[channel] += window[k];
+					}
 				}
 			}
 		}
-		//save last sample
-		for (int channel = 0; channel < mNumChannels; ++channel)
-		{
-			mLastSample[channel] = mSideChain.getWritePointer(channel)[mBlockSize-1];
-		}
+	}
+#endif
+
+	//restart the sliding window (on a Detector change, so a window never mixes peaks and squares)
+	void resetWindow() noexcept
+	{
+		mChunkCounter = 0;
+#if JUCE_USE_SIMD
+		mWindow.clear();
+		mPrefixMax = mSum = mCompensation = 0;
+		for (auto& state : mGroupStates)
+			state.prefixMax = state.sum = state.compensation = 0;
+#else
+		mWindow.clear();
+		for (int channel = 0; channel < maxBands * mNumChannels; ++channel)
+			mPrefixMax[channel] = mSum[channel] = mCompensation[channel] = 0;
 #endif
 	}
 
 	//dynamic waveshaping variables
-	OwnedArray<dsp::LookupTableTransform<float>> mTargetWaveshapers; //smart array that deletes objects in destructor
-	AudioBuffer<float> mSideChain;
+	AudioBuffer<SampleType> mSideChain;
 
 	//envelope variables
 	int mChunkSize, mChunkCounter = 0;
 #if JUCE_USE_SIMD
-	dsp::SIMDRegister<float> mLastSample = 0, mChunkMaxIn = 0, mSideChainThreshIn = 0;
-	//data used to interleave mChannelPointers data into interleavedBlockData
-	dsp::AudioBlock<dsp::SIMDRegister<float>> mInterleaved;
-	dsp::AudioBlock<float> mZero;
-	HeapBlock<char> interleavedBlockData, zeroData;
-	HeapBlock<const float*> mChannelPointers{ dsp::SIMDRegister<float>::size() };
+	dsp::SIMDRegister<SampleType> mLastSample = 0, mChunkMaxIn = 0, mSideChainThreshIn = 0;
+	//packs every channel into the lanes of one SIMD register (one group), or the band channels into as few groups as they fit
+	SIMDInterleaver<SampleType> mInterleaver;
+#else
+	std::unique_ptr<SampleType[]> mLastSample, mChunkMaxIn, mSideChainThreshIn; //use smart pointer to construct in prepare and auto delete in destructor
+#endif
+
+	//sliding window detector variables: the window of one chunk (abs or squared input) and the last chunk's suffix maxima (one sample longer,
+	//its last sample stays 0), prefix maximum, and running sum with its compensation
+	SampleType mWindowScale = 1;
+#if JUCE_USE_SIMD
+	dsp::AudioBlock<dsp::SIMDRegister<SampleType>> mWindow; //window and suffix channel pairs per group
+	HeapBlock<char> mWindowData;
+	dsp::SIMDRegister<SampleType> mPrefixMax = 0, mSum = 0, mCompensation = 0;
+#else
+	AudioBuffer<SampleType> mWindow; //window and suffix channel pairs
+	std::unique_ptr<SampleType[]> mPrefixMax, mSum, mCompensation, mLevel;
+#endif
+
+	//Bands of 2 or more: split the input (and an external key) into band channels, detect and shape every band channel like a channel of
+	//the full band, and sum the bands back into outputBlock (the bands take the same Lookahead delay)
+	template <typename InputBlock, typename OutputBlock>
+	void processBands(const InputBlock& inputBlock, OutputBlock& outputBlock) noexcept
+	{
+		for (int channel = 0; channel < mNumChannels; ++channel)
+			mInputPointers[channel] = inputBlock.getChannelPointer(static_cast<size_t> (channel));
+		if (mExternalKey)
+		{
+			updateBands<false, true>(mKeyPointers.getData(), mCrossover.getChannelPointer(2));
+			updateBands<true, false>(mInputPointers.getData(), mCrossover.getChannelPointer(1));
+		}
+		else
+		{
+			updateBands<true, true>(mInputPointers.getData(), mCrossover.getChannelPointer(1));
+		}
+
+		//Low Drive and High Drive
+		for (int channel = 0; channel < mNumChannels; ++channel)
+		{
+			FloatVectorOperations::multiply(mSideChain.getWritePointer(channel), mBufLowDrive, mNumSamples);
+			FloatVectorOperations::multiply(mSideChain.getWritePointer((mBufBands - 1) * mNumChannels + channel), mBufHighDrive, mNumSamples);
+		}
+
+		dsp::AudioBlock<SampleType> bands(mBands.getArrayOfWritePointers(), static_cast<size_t> (mNumBandChannels), static_cast<size_t> (mNumSamples));
+		mLookahead.process(bands);
+		shape(bands, bands);
+		for (int channel = 0; channel < mNumChannels; ++channel)
+		{
+			auto* output = outputBlock.getChannelPointer(static_cast<size_t> (channel));
+			FloatVectorOperations::copy(output, mBands.getReadPointer(channel), mNumSamples);
+			for (int band = 1; band < mBufBands; ++band)
+				FloatVectorOperations::add(output, mBands.getReadPointer(band * mNumChannels + channel), mNumSamples);
+		}
+	}
+
+#if JUCE_USE_SIMD
+	//split channels into band lanes and run them through the crossover with state, one group of lanes at a time: Keep deinterleaves the
+	//bands into mBands, Detect runs the detector over them into the side chain (every group from the same chunk position with its own
+	//detector state), so all bands of a group cost one pass of each stage
+	template <bool Keep, bool Detect>
+	void updateBands(const SampleType* const* channels, dsp::SIMDRegister<SampleType>* state) noexcept
+	{
+		const int numLanes = mNumGroups * SIMDInterleaver<SampleType>::lanes;
+		for (int lane = 0; lane < numLanes; ++lane)
+			mLaneInputs[lane] = channels[jmax(0, mLaneBandChannels[lane]) % mNumChannels];
+		const int chunkCounter = mChunkCounter;
+		for (int group = 0; group < mNumGroups; ++group)
+		{
+			auto* interleaved = mInterleaver.interleave(group, mLaneInputs.getData(), numLanes, mNumSamples);
+			processCrossover(interleaved, state + group * crossoverStateSize, mCrossover.getChannelPointer(0) + group * numCrossoverCoefficients);
+			if (Keep)
+				mInterleaver.deinterleave(group, mBandOutputs.getData(), numLanes, mNumSamples);
+			if (Detect)
+			{
+				mChunkCounter = chunkCounter;
+				swapGroupState(group);
+				detect(interleaved, group);
+				swapGroupState(group);
+				mInterleaver.deinterleave(group, mSideChainOutputs.getData(), numLanes, mNumSamples);
+			}
+		}
+	}
+
+	//swap the detector state of group (> 0) with group 0's in the members, so detect runs on any group (a second swap swaps back)
+	void swapGroupState(int group) noexcept
+	{
+		if (group == 0)
+			return;
+		auto& state = mGroupStates[static_cast<size_t> (group - 1)];
+		std::swap(mLastSample, state.lastSample);
+		std::swap(mChunkMaxIn, state.chunkMaxIn);
+		std::swap(mSideChainThreshIn, state.threshIn);
+		std::swap(mPrefixMax, state.prefixMax);
+		std::swap(mSum, state.sum);
+		std::swap(mCompensation, state.compensation);
+	}
+#else
+	//split channels into mBands through the crossover with state, then detect from the bands when Detect (the bands are always kept, so
+	//an external key is split and detected before the input overwrites it)
+	template <bool Keep, bool Detect>
+	void updateBands(const SampleType* const* channels, SampleType* state) noexcept
+	{
+		for (int channel = 0; channel < mNumBandChannels; ++channel)
+		{
+			SampleType* band = mBands.getWritePointer(channel);
+			FloatVectorOperations::copy(band, channels[channel % mNumChannels], mNumSamples);
+			processCrossover(band, state + channel * crossoverStateSize, mCrossover.getChannelPointer(0) + (channel / mNumChannels) * numCrossoverCoefficients);
+		}
+		if (Detect)
+			updateSideChain(dsp::AudioBlock<const SampleType>(mBands.getArrayOfReadPointers(), static_cast<size_t> (mNumBandChannels), static_cast<size_t> (mNumSamples)));
+	}
+#endif
+
+	//run the crossover sections of the current Bands over a block in place using transposed direct form II, as BBDFilter does (Vec is
+	//SampleType or SIMDRegister<SampleType>, whose lanes can each carry another band's coefficients)
+	template <typename Vec>
+	void processCrossover(Vec* data, Vec* state, const Vec* coefficients) const noexcept
+	{
+		for (int section = 0; section < mNumCrossoverSections; ++section)
+		{
+			const Vec* c = coefficients + section * 5;
+			const Vec b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+			Vec s1 = state[section * 2], s2 = state[section * 2 + 1];
+			for (int i = 0; i < mNumSamples; ++i)
+			{
+				const Vec x = data[i];
+				const Vec y = b0 * x + s1;
+				s1 = b1 * x - a1 * y + s2;
+				s2 = b2 * x - a2 * y;
+				data[i] = y;
+			}
+			state[section * 2] = s1;
+			state[section * 2 + 1] = s2;
+		}
+	}
+
+	//lay the band channels out for the current Bands and restart every band from silence (on a Bands change)
+	void prepareBands() noexcept;
+
+	//design the crossover sections of every band (or lane) for the current Bands
+	void updateCrossover(float hzLowCrossover, float hzHighCrossover) noexcept;
+
+	//crossover sections per band: two Butterworth biquads (b0, b1, b2, a1, a2) at each crossover, two states each
+	enum { numCrossoverSections = 4, numCrossoverCoefficients = numCrossoverSections * 5, crossoverStateSize = numCrossoverSections * 2 };
+
+	//band variables: band b of channel c is band channel b * mNumChannels + c; the crossover holds the coefficients of every band (SIMD: of
+	//every lane of every group), then the input's and the external key's filter states
+#if JUCE_USE_SIMD
+	dsp::AudioBlock<dsp::SIMDRegister<SampleType>> mCrossover;
 #else
-	std::unique_ptr<float[]> mLastSample, mChunkMaxIn, mSideChainThreshIn; //use smart pointer to construct in prepare and auto delete in destructor
+	dsp::AudioBlock<SampleType> mCrossover;
 #endif
-	//chebyshev polynomials of the first kind
-	static float T_2(float x)
+	HeapBlock<char> mCrossoverData;
+	AudioBuffer<SampleType> mBands;
+	HeapBlock<const SampleType*> mInputPointers;
+	int mNumBandChannels = 0, mNumCrossoverSections = 0;
+#if JUCE_USE_SIMD
+	//as many bands per group as fit whole (a band's channels stay in one register for Stereo Link); lanes past them carry no band (-1) and
+	//write to mDiscard
+	struct GroupState
 	{
-		return 2 * x * x - 1.0f;
+		dsp::SIMDRegister<SampleType> lastSample = 0, chunkMaxIn = 0, threshIn = 0, prefixMax = 0, sum = 0, compensation = 0;
+	};
+	std::array<GroupState, maxBands - 1> mGroupStates;
+	HeapBlock<int> mLaneBandChannels;
+	HeapBlock<const SampleType*> mLaneInputs;
+	HeapBlock<SampleType*> mBandOutputs, mSideChainOutputs;
+	HeapBlock<SampleType> mDiscard;
+	int mNumGroups = 1;
+#endif
+
+	//blend inputBlock towards the current waveshaping into outputBlock by the side chain (the blocks may be the same)
+	template <typename InputBlock, typename OutputBlock>
+	void shape(const InputBlock& inputBlock, OutputBlock& outputBlock) noexcept
+	{
+		//without ADAA only the last two inputs are kept, before the blocks are overwritten
+		if (mBufAntialiasing == 0)
+			keepHistory(inputBlock);
+		const bool fading = mFadePosition < mFadeLength;
+		if (mBufAntialiasing == 1)
+			fading ? processAntialiased<1, true>(inputBlock, outputBlock) : processAntialiased<1, false>(inputBlock, outputBlock);
+		else if (mBufAntialiasing == 2)
+			fading ? processAntialiased<2, true>(inputBlock, outputBlock) : processAntialiased<2, false>(inputBlock, outputBlock);
+		else if (fading)
+			crossfadeWaveshapers(inputBlock, outputBlock);
+		else
+		{
+			//apply amount of waveshaping proportional to sidechain signal
+			const SampleType* table = mBufCurves[mBufCurve].table.data();
+			for (int channel = 0; channel < mNumBandChannels; ++channel) {
+				for (int i = 0; i < mNumSamples; ++i) {
+					outputBlock.getChannelPointer(channel)[i] = std::lerp(
+						inputBlock.getChannelPointer(channel)[i],
+						dlay::lookupWaveshaper(table, inputBlock.getChannelPointer(channel)[i]),
+						mSideChain.getSample(channel, i)
+					);
+				}
+			}
+		}
 	}
-	static float T_3(float x)
+
+	//transition block: blend the old and new target waveshapers' outputs with a linear (equal-gain) fade, since both shape the same input
+	//and are strongly correlated (an equal-power fade would swell by up to 3dB halfway)
+	template <typename InputBlock, typename OutputBlock>
+	void crossfadeWaveshapers(const InputBlock& inputBlock, OutputBlock& outputBlock) noexcept
 	{
-		return (4.0f * pow(x, 3)) - 3.0f * x;
+		const SampleType* from = mBufCurves[mBufCurve ^ 1].table.data();
+		const SampleType* to = mBufCurves[mBufCurve].table.data();
+		for (int channel = 0; channel < mNumBandChannels; ++channel)
+		{
+			for (int i = 0; i < mNumSamples; ++i)
+			{
+				const SampleType x = inputBlock.getChannelPointer(channel)[i];
+				const SampleType progress = jmin(static_cast<SampleType> (1), static_cast<SampleType> (mFadePosition + i) / static_cast<SampleType> (mFadeLength));
+				const SampleType target = std::lerp(dlay::lookupWaveshaper(from, x), dlay::lookupWaveshaper(to, x), progress);
+				outputBlock.getChannelPointer(channel)[i] = std::lerp(x, target, mSideChain.getSample(channel, i));
+			}
+		}
+		mFadePosition = jmin(mFadePosition + mNumSamples, mFadeLength);
 	}
-	static float T_4(float x)
+
+	//ADAA of Order over the block: the inputs follow two samples of history in mHistory, so the loops carry no recurrence (they read
+	//earlier inputs, never outputs) and vectorise across samples; the dry part of the blend goes through the identity's ADAA so shaped
+	//and dry stay aligned; Fading blends the old curve's ADAA in as crossfadeWaveshapers does
+	template <int Order, bool Fading, typename InputBlock, typename OutputBlock>
+	void processAntialiased(const InputBlock& inputBlock, OutputBlock& outputBlock) noexcept
 	{
-		return (8.0f * pow(x, 4)) - (8.0f * x * x) + 1.0f;
+		const Curve& to = mBufCurves[mBufCurve];
+		const Curve& from = mBufCurves[mBufCurve ^ 1];
+		for (int channel = 0; channel < mNumBandChannels; ++channel)
+		{
+			double* x = mHistory.getWritePointer(channel);
+			const auto* input = inputBlock.getChannelPointer(channel);
+			for (int i = 0; i < mNumSamples; ++i)
+				x[i + 2] = static_cast<double> (input[i]);
+
+			auto* output = outputBlock.getChannelPointer(channel);
+			const SampleType* sideChain = mSideChain.getReadPointer(channel);
+			for (int i = 0; i < mNumSamples; ++i)
+			{
+				double shaped = (Order == 1) ? to.adaa1(x[i + 2], x[i + 1]) : to.adaa2(x[i + 2], x[i + 1], x[i]);
+				if (Fading)
+				{
+					const double progress = jmin(1.0, static_cast<double> (mFadePosition + i) / static_cast<double> (mFadeLength));
+					const double old = (Order == 1) ? from.adaa1(x[i + 2], x[i + 1]) : from.adaa2(x[i + 2], x[i + 1], x[i]);
+					shaped = old + progress * (shaped - old);
+				}
+				const double dry = (Order == 1) ? Curve::identity1(x[i + 2], x[i + 1]) : Curve::identity2(x[i + 2], x[i + 1], x[i]);
+				output[i] = static_cast<SampleType> (dry + static_cast<double> (sideChain[i]) * (shaped - dry));
+			}
+			x[0] = x[mNumSamples];
+			x[1] = x[mNumSamples + 1];
+		}
+		if (Fading)
+			mFadePosition = jmin(mFadePosition + mNumSamples, mFadeLength);
 	}
-	//called once per process
+
+	//keep the last two inputs while ADAA is off, so switching it on starts from the real signal (a one sample block keeps the newest
+	//history sample as the older one)
+	template <typename InputBlock>
+	void keepHistory(const InputBlock& inputBlock) noexcept
+	{
+		if (mNumSamples < 1)
+			return;
+		for (int channel = 0; channel < mNumBandChannels; ++channel)
+		{
+			double* x = mHistory.getWritePointer(channel);
+			const auto* input = inputBlock.getChannelPointer(channel);
+			x[0] = mNumSamples < 2 ? x[1] : static_cast<double> (input[mNumSamples - 2]);
+			x[1] = static_cast<double> (input[mNumSamples - 1]);
+		}
+	}
+
+	//called once per process: one snapshot acquire, coefficients recomputed only when a new version was published
+	//the snapshot carries only the waveshaper position, so a new position is blended into the spare curve slot here; a position jump (a
+	//Target Waveshaper change, or Character jumping) starts a transition from the old curve while small steps (Character moving smoothly)
+	//switch directly; a Target Waveshaper change that keeps the position rebuilds nothing and so fades nothing; only the curve waits for a
+	//running transition (a new position published during one is switched to when it ends), every other parameter applies on the next block
 	void updateBufParams() noexcept
 	{
-		mBufThreshold = mThreshold.get();
-		mBufAttackCoeff = mAttackCoeff.get();
-		mBufReleaseCoeff = mReleaseCoeff.get();
-		mBufTargetWaveshaper = mTargetWaveshaper.get();
+		const auto& parameters = mParameters.acquire();
+		const bool prepared = mBufVersion != -1;
+		if (mParameters.getVersion() != mBufVersion)
+		{
+			mBufVersion = mParameters.getVersion();
+			mBufThreshold = static_cast<SampleType> (parameters.threshold);
+			mBufAttackCoeff = static_cast<SampleType> (static_cast<float> (exp(-1000 / (parameters.msAttack * mSampleRate))));
+			mBufReleaseCoeff = static_cast<SampleType> (static_cast<float> (exp(-1000 / (parameters.msRelease * mSampleRate))));
+			mBufAntialiasing = parameters.antialiasing;
+			if (!prepared || parameters.bands != mBufBands)
+			{
+				mBufBands = parameters.bands;
+				prepareBands();
+			}
+			updateCrossover(parameters.hzLowCrossover, parameters.hzHighCrossover);
+			mBufLowDrive = static_cast<SampleType> (parameters.lowDrive);
+			mBufHighDrive = static_cast<SampleType> (parameters.highDrive);
+			if (parameters.detector != mBufDetector)
+				resetWindow();
+			mBufDetector = parameters.detector;
+			mBufStereoLink = parameters.stereoLink;
+			mLookahead.setDelay(roundToInt(parameters.msLookahead * 0.001f * static_cast<float> (mSampleRate)));
+
+			//knee from Threshold - Knee / 2 to Threshold + Knee / 2 (squared for RMS); a hard threshold scales by a huge gain instead
+			const float kneeGain = Decibels::decibelsToGain(0.5f * parameters.knee);
+			float kneeStart = parameters.threshold / kneeGain, kneeEnd = parameters.threshold * kneeGain;
+			if (parameters.detector == rms)
+			{
+				kneeStart *= kneeStart;
+				kneeEnd *= kneeEnd;
+			}
+			mBufKneeStart = static_cast<SampleType> (kneeStart);
+			mBufKneeScale = static_cast<SampleType> (kneeEnd > kneeStart ? 1.0f / (kneeEnd - kneeStart) : 1.0e30f);
+		}
+
+		//the curve, once no transition runs
+		if (mFadePosition < mFadeLength || (prepared && parameters.getPosition() == mBufPosition))
+			return;
+		const bool jumped = prepared && std::abs(parameters.getPosition() - mBufPosition) > maxDirectPositionStep;
+		mBufPosition = parameters.getPosition();
+		mBufCurve ^= 1;
+		mBufCurves[mBufCurve].morph(mBufPosition);
+		mFadeLength = roundToInt(parameters.msCrossfade * 0.001f * static_cast<float> (mSampleRate));
+		mFadePosition = jumped ? 0 : mFadeLength;
 	}
 
-	//parameters updated via Atomic loads once per buffer
+	//parameters derived from the snapshot version mBufVersion (-1 forces an update, e.g. after a sample rate change)
 #if JUCE_USE_SIMD
-	dsp::SIMDRegister<float> mBufThreshold, mBufAttackCoeff, mBufReleaseCoeff;
-	const dsp::SIMDRegister<float> ONE = 1.0f, ZERO = 0.0f;
+	dsp::SIMDRegister<SampleType> mBufThreshold, mBufAttackCoeff, mBufReleaseCoeff, mBufKneeStart, mBufKneeScale;
+	const dsp::SIMDRegister<SampleType> ONE = 1, ZERO = 0, TWO = 2, THREE = 3;
 #else
-	float mBufThreshold, mBufAttackCoeff, mBufReleaseCoeff;
+	SampleType mBufThreshold, mBufAttackCoeff, mBufReleaseCoeff, mBufKneeStart, mBufKneeScale;
 #endif
-	int mBufTargetWaveshaper;
+	SampleType mBufLowDrive = 1, mBufHighDrive = 1;
+	int mBufAntialiasing = 0, mBufDetector = chunkGate, mBufBands = 1, mBufVersion = -1;
+	bool mBufStereoLink = false;
+
+	//waveshaper curves (table and antiderivatives): the one in use and the one before it (faded out during a transition), owned here and
+	//blended from the target curves on the audio thread, so publishing a parameter copies no curve; position steps up to
+	//maxDirectPositionStep switch curves directly, larger ones fade
+	static constexpr float maxDirectPositionStep = 0.05f;
+	using Curve = dlay::IntegratedWaveshaper<SampleType>;
+	std::array<Curve, 2> mBufCurves;
+	int mBufCurve = 0;
+	float mBufPosition = 0.0f;
+
+	//last two inputs before the block, then the block (double, as ADAA takes differences of them)
+	AudioBuffer<double> mHistory;
+
+	//Lookahead delay on the shaped audio
+	ShortDelay<SampleType> mLookahead;
+
+	//external side chain channels (see setExternalKey)
+	HeapBlock<const SampleType*> mKeyPointers;
+	bool mExternalKey = false;
+
+	//transition progress in samples
+	int mFadePosition = 0, mFadeLength = 0;
+
+	//processing parameters published as one coherent set (units: gain, ms, ms, choice, [0, 3], ms, order, Detector, dB, On/Off, ms, bands,
+	//Hz, Hz, gain, gain)
+	struct Parameters
+	{
+		float threshold = 0.1f, msAttack = 50.0f, msRelease = 100.0f;
+		int targetWaveshaper = 0;
+		float character = 0.0f, msCrossfade = 20.0f;
+		int antialiasing = 0, detector = chunkGate;
+		float knee = 0.0f;
+		bool stereoLink = false;
+		float msLookahead = 0.0f;
+		int bands = 1;
+		float hzLowCrossover = 250.0f, hzHighCrossover = 3000.0f, lowDrive = 1.0f, highDrive = 1.0f;
 
-	//instantaneous processing parameters wrapped in Atomic for thread safety (units: gain, coefficient, coefficient)
-	Atomic<float> mThreshold = 0.1f, mAttackCoeff = 0.99f, mReleaseCoeff = 0.99f;
-	Atomic<int> mTargetWaveshaper = 0;
+		float getPosition() const noexcept { return dlay::getWaveshaperPosition(targetWaveshaper, character); }
+	};
+	ParameterSnapshot<Parameters> mParameters;
 
-	//environment variables
-	int mBlockSize, mNumChannels, mSampleRate;
+	//environment variables, and the samples of the block being processed (at most mBlockSize)
+	int mBlockSize = 0, mNumChannels = 0, mSampleRate = 44100, mNumSamples = 0;
 };
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "OfflineRender.h"
+
+bool OfflineRender::setParameter(AudioProcessor& processor, StringRef parameterID, float plainValue)
+{
+	for (auto* parameter : processor.getParameters())
+	{
+		if (auto* ranged = dynamic_cast<RangedAudioParameter*> (parameter))
+		{
+			if (ranged->paramID == parameterID)
+			{
+				ranged->setValueNotifyingHost(ranged->convertTo0to1(plainValue));
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+AudioBuffer<float> OfflineRender::render(AudioProcessor& processor, const AudioBuffer<float>& input, double sampleRate, int blockSize)
+{
+	//prepare from a clean state (prepareToPlay clears delay memory and envelopes and applies the parameter state)
+	processor.setRateAndBufferSize(sampleRate, blockSize);
+	processor.prepareToPlay(sampleRate, blockSize);
+
+	const int numChannels = jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+	const int numSamples = input.getNumSamples();
+	AudioBuffer<float> output(processor.getTotalNumOutputChannels(), numSamples);
+	AudioBuffer<float> block(numChannels, blockSize);
+	MidiBuffer midi;
+
+	//every block has the prepared size, since the modular delay advances a block at a time; the render runs latency samples longer and drops the
+	//first latency samples, as a host's delay compensation would
+	const int latency = processor.getLatencySamples();
+	for (int start = 0; start < numSamples + latency; start += blockSize)
+	{
+		block.clear();
+		const int length = jmax(0, jmin(blockSize, numSamples - start));
+		for (int channel = 0; channel < jmin(numChannels, input.getNumChannels()) && length > 0; ++channel)
+			block.copyFrom(channel, 0, input, channel, start, length);
+		processor.processBlock(block, midi);
+		const int skip = jmax(0, latency - start), outputLength = jmin(blockSize - skip, numSamples - (start + skip - latency));
+		for (int channel = 0; channel < output.getNumChannels() && outputLength > 0; ++channel)
+			output.copyFrom(channel, start + skip - latency, block, channel, skip, outputLength);
+	}
+
+	processor.releaseResources();
+	return output;
+}
+
+AudioBuffer<float> OfflineRender::makeTestSignal(double sampleRate, double seconds)
+{
+	const int numSamples = roundToInt(sampleRate * seconds);
+	AudioBuffer<float> signal(2, numSamples);
+	signal.clear();
+	Random random(0x0d1a7); //fixed seed
+
+	for (int channel = 0; channel < signal.getNumChannels(); ++channel)
+	{
+		float* data = signal.getWritePointer(channel);
+		//impulse
+		data[0] = 1.0f;
+		//decaying 440Hz (left) / 660Hz (right) burst from 100ms to 400ms
+		const double hz = (channel == 0) ? 440.0 : 660.0;
+		for (int i = roundToInt(0.1 * sampleRate); i < jmin(numSamples, roundToInt(0.4 * sampleRate)); ++i)
+		{
+			const double t = i / sampleRate - 0.1;
+			data[i] += static_cast<float> (0.8 * std::exp(-6.0 * t) * std::sin(MathConstants<double>::twoPi * hz * t));
+		}
+		//-20dB noise burst from 500ms to 600ms
+		for (int i = roundToInt(0.5 * sampleRate); i < jmin(numSamples, roundToInt(0.6 * sampleRate)); ++i)
+			data[i] += 0.1f * (random.nextFloat() * 2.0f - 1.0f);
+	}
+	return signal;
+}
+
+Array<OfflineRender::Case> OfflineRender::getDefaultCases()
+{
+	const StringArray shapers{ "linear", "bbd", "tube", "smashed" };
+	const StringArray modes{ "digital", "analog", "compander" };
+	const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+	const int blockSizes[] = { 64, 441, 512 }; //441 is not a power of two, so at 48kHz and 96kHz delay writes wrap mid block
+
+	auto makeCase = [&](int shaper, int mode, double sampleRate, int blockSize) -> Case
+	{
+		StringPairArray parameters;
+		parameters.set("targetWaveshaper", String(shaper));
+		parameters.set("analog", (mode > 0) ? "1" : "0");
+		parameters.set("compander", (mode > 1) ? "1" : "0");
+		parameters.set("threshold", "-40"); //make sure the waveshaper engages on the test signal
+		return { shapers[shaper] + "_" + modes[mode] + "_" + String(roundToInt(sampleRate)) + "_" + String(blockSize), parameters, sampleRate, blockSize };
+	};
+
+	//every setting at 48kHz with 512 sample blocks
+	Array<Case> cases;
+	for (int shaper = 0; shaper < shapers.size(); ++shaper)
+		for (int mode = 0; mode < modes.size(); ++mode)
+			cases.add(makeCase(shaper, mode, 48000.0, 512));
+
+	//the sample rate x block size matrix with every stage engaged (tube through the compander)
+	for (auto sampleRate : sampleRates)
+		for (auto blockSize : blockSizes)
+			if (sampleRate != 48000.0 || blockSize != 512)
+				cases.add(makeCase(shapers.indexOf("tube"), modes.indexOf("compander"), sampleRate, blockSize));
+	return cases;
+}
+
+Array<OfflineRender::Result> OfflineRender::runGoldenSuite(const File& directory, const Array<Case>& cases, float tolerance, bool regenerate)
+{
+	WavAudioFormat wav;
+	Array<Result> results;
+	for (const auto& c : cases)
+	{
+		Result result;
+		result.name = c.name;
+
+		//render the case with a fresh processor
+		DlayAudioProcessor processor;
+		for (const auto& key : c.parameters.getAllKeys())
+			setParameter(processor, key, c.parameters[key].getFloatValue());
+		const auto rendered = render(processor, makeTestSignal(c.sampleRate), c.sampleRate, c.blockSize);
+
+		const File golden = directory.getChildFile(c.name + ".wav");
+		if (regenerate)
+		{
+			//write 32 bit float so goldens are exact
+			golden.deleteFile();
+			std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(new FileOutputStream(golden), c.sampleRate,
+				static_cast<unsigned int> (rendered.getNumChannels()), 32, {}, 0));
+			result.passed = writer != nullptr && writer->writeFromAudioSampleBuffer(rendered, 0, rendered.getNumSamples());
+		}
+		else if (std::unique_ptr<AudioFormatReader> reader{ wav.createReaderFor(new FileInputStream(golden), true) })
+		{
+			AudioBuffer<float> expected(static_cast<int> (reader->numChannels), static_cast<int> (reader->lengthInSamples));
+			reader->read(&expected, 0, expected.getNumSamples(), 0, true, true);
+			result.maxError = compare(rendered, expected, tolerance, result.firstErrorSample);
+			result.passed = result.maxError <= tolerance;
+		}
+		else
+		{
+			result.missingGolden = true;
+		}
+		results.add(result);
+	}
+	return results;
+}
+
+float OfflineRender::compare(const AudioBuffer<float>& rendered, const AudioBuffer<float>& golden, float tolerance, int& firstErrorSample)
+{
+	firstErrorSample = -1;
+	if (rendered.getNumChannels() != golden.getNumChannels() || rendered.getNumSamples() != golden.getNumSamples())
+	{
+		firstErrorSample = 0;
+		return std::numeric_limits<float>::infinity();
+	}
+
+	float maxError = 0.0f;
+	for (int channel = 0; channel < rendered.getNumChannels(); ++channel)
+	{
+		const float* a = rendered.getReadPointer(channel);
+		const float* b = golden.getReadPointer(channel);
+		for (int i = 0; i < rendered.getNumSamples(); ++i)
+		{
+			const float error = std::abs(a[i] - b[i]);
+			if (!(error <= tolerance) && (firstErrorSample < 0 || i < firstErrorSample)) //NaNs count as errors
+				firstErrorSample = i;
+			maxError = jmax(maxError, std::isnan(error) ? std::numeric_limits<float>::infinity() : error);
+		}
+	}
+	return maxError;
+}
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//Repeatable offline renders through DlayAudioProcessor and golden file regression checks of those renders
+class OfflineRender
+{
+public:
+
+	//one golden render configuration
+	struct Case
+	{
+		String name; //golden file stem
+		StringPairArray parameters; //parameter ID -> plain value, applied on top of defaults
+		double sampleRate;
+		int blockSize;
+	};
+
+	//outcome of one case
+	struct Result
+	{
+		String name;
+		bool passed = false, missingGolden = false;
+		float maxError = 0.0f;
+		int firstErrorSample = -1;
+	};
+
+	// Rendering
+	//==============================================================================
+
+	//set a parameter by ID using its plain (unnormalised) value
+	static bool setParameter(AudioProcessor& processor, StringRef parameterID, float plainValue);
+
+	//prepare processor from a clean state and render input in blocks of blockSize (the tail is zero padded to a whole block)
+	static AudioBuffer<float> render(AudioProcessor& processor, const AudioBuffer<float>& input, double sampleRate, int blockSize);
+
+	//fixed stereo test signal: impulse, decaying sine burst, and seeded noise burst
+	static AudioBuffer<float> makeTestSignal(double sampleRate, double seconds = 1.0);
+
+	// Golden Files
+	//==============================================================================
+
+	//every target waveshaper with Analog off/on and with the compander at 48kHz with 512 sample blocks, plus the tube compander case at
+	//44.1kHz, 48kHz and 96kHz with 64, 441 and 512 sample blocks
+	static Array<Case> getDefaultCases();
+
+	//render every case and compare it against <directory>/<name>.wav within tolerance (or overwrite the golden file when regenerate is true)
+	static Array<Result> runGoldenSuite(const File& directory, const Array<Case>& cases, float tolerance, bool regenerate);
+
+	//largest absolute difference between two renders; sets firstErrorSample to the first sample off by more than tolerance (-1 if none)
+	static float compare(const AudioBuffer<float>& rendered, const AudioBuffer<float>& golden, float tolerance, int& firstErrorSample);
+};
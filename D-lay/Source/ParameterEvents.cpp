@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "ParameterEvents.h"
+
+bool ParameterEvents::add(int sampleOffset, int parameter, float value) noexcept
+{
+	if (mNumEvents == capacity)
+		return false;
+
+	//events mostly arrive in order, so the insertion point is almost always the end
+	int position = mNumEvents;
+	while (position > 0 && mEvents[position - 1].sampleOffset > sampleOffset)
+	{
+		mEvents[position] = mEvents[position - 1];
+		--position;
+	}
+	mEvents[position] = { sampleOffset, parameter, value };
+	++mNumEvents;
+	return true;
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Timestamped parameter changes of one block, kept sorted by sample offset so the processor can split the block at each change
+//events come from MIDI controllers (see getParameterForController) and from add() on the audio thread before processBlock
+//storage is fixed, so collecting events never allocates; events past capacity are dropped (the value tree still gets the block's last value)
+class ParameterEvents
+{
+public:
+
+	//one change: parameter index (DlayAudioProcessor::Parameter) set to a plain (unnormalised) value at sampleOffset
+	struct Event
+	{
+		int sampleOffset, parameter;
+		float value;
+	};
+
+	enum { capacity = 1024 };
+
+	//parameter index controlled by a MIDI controller number, or -1: the controllers the MIDI spec leaves undefined, CC 20-31 for
+	//parameters 0-11 and CC 102-119 for parameters 12-29
+	static int getParameterForController(int controller) noexcept
+	{
+		if (controller >= 20 && controller <= 31)
+			return controller - 20;
+		if (controller >= 102 && controller <= 119)
+			return controller - 102 + 12;
+		return -1;
+	}
+
+	// Essential Methods
+	//==============================================================================
+
+	//insert an event after any others at the same offset (audio thread); returns false when full
+	bool add(int sampleOffset, int parameter, float value) noexcept;
+
+	//add every controller event of midi that maps to one of numParameters parameters, converting 0-127 values with
+	//toPlain(parameter, normalisedValue), and clamp every offset into [0, numSamples) (audio thread, once per block)
+	template <typename ToPlain>
+	void collect(const MidiBuffer& midi, int numParameters, int numSamples, ToPlain&& toPlain) noexcept
+	{
+		MidiMessage message;
+		int sampleOffset = 0;
+		for (MidiBuffer::Iterator iterator(midi); iterator.getNextEvent(message, sampleOffset);)
+		{
+			if (!message.isController())
+				continue;
+			const int parameter = getParameterForController(message.getControllerNumber());
+			if (parameter >= 0 && parameter < numParameters)
+				add(sampleOffset, parameter, toPlain(parameter, static_cast<float> (message.getControllerValue()) / 127.0f));
+		}
+		for (int i = 0; i < mNumEvents; ++i)
+			mEvents[i].sampleOffset = jlimit(0, jmax(0, numSamples - 1), mEvents[i].sampleOffset);
+	}
+
+	//forget every event (after the block has used them)
+	void clear() noexcept { mNumEvents = 0; }
+
+	//sorted events
+	int size() const noexcept { return mNumEvents; }
+	const Event& operator[](int index) const noexcept { return mEvents[index]; }
+
+private:
+
+	std::array<Event, capacity> mEvents;
+	int mNumEvents = 0;
+};
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Marks the audio thread while it applies timestamped parameter events: in scope, ParameterSnapshot::publish changes the audio thread's
+//current copy in place instead (no lock, no waiting), which lasts until a publish from another thread replaces it, so owners publish the
+//same change again from the message thread once the block is done (see DlayAudioProcessor::timerCallback)
+class AudioThreadChanges
+{
+public:
+
+	AudioThreadChanges() noexcept { isActive() = true; }
+	~AudioThreadChanges() noexcept { isActive() = false; }
+
+	//whether the calling thread is in scope
+	static bool& isActive() noexcept
+	{
+		static thread_local bool active = false;
+		return active;
+	}
+
+private:
+
+	JUCE_DECLARE_NON_COPYABLE(AudioThreadChanges)
+};
+
+//Versioned, lock-free snapshot of a whole parameter struct: setters publish from any thread, the audio thread reads once per block
+//triple buffer: a publish fills the back copy and swaps it with the middle one; acquire swaps the middle copy for the front one only when
+//a newer copy was published, so the audio thread never waits and never sees fields of two different publishes
+template <typename Parameters>
+class ParameterSnapshot
+{
+public:
+
+	// Essential Methods
+	//==============================================================================
+
+	//apply modify(Parameters&) to the latest parameters and publish a copy with the next version (any thread but the audio thread; writers take turns)
+	//inside an AudioThreadChanges scope, apply it to the audio thread's current copy instead, under a new negative version
+	template <typename Modify>
+	void publish(Modify&& modify) noexcept
+	{
+		if (AudioThreadChanges::isActive())
+		{
+			acquire();
+			modify(mCopies[mFront].parameters);
+			mCopies[mFront].version = --mAudioThreadVersion;
+			return;
+		}
+		const SpinLock::ScopedLockType lock(mWriteLock);
+		modify(mLatest);
+		mCopies[mBack] = { mLatest, ++mVersion };
+		mBack = mMiddle.exchange(mBack | fresh) & indexMask;
+	}
+
+	//take the newest published copy if there is one and return the current parameters (audio thread only, once per block)
+	const Parameters& acquire() noexcept
+	{
+		if ((mMiddle.get() & fresh) != 0)
+			mFront = mMiddle.exchange(mFront) & indexMask;
+		return mCopies[mFront].parameters;
+	}
+
+	//version of the parameters returned by the last acquire (0 until the first publish, below -1 after an audio thread change); derived
+	//coefficients need recomputing when it changes
+	int getVersion() const noexcept { return mCopies[mFront].version; }
+
+	//latest published parameters (any thread but the audio thread)
+	Parameters getLatest() const noexcept
+	{
+		const SpinLock::ScopedLockType lock(mWriteLock);
+		return mLatest;
+	}
+
+private:
+
+	enum { indexMask = 3, fresh = 4 };
+
+	struct Copy
+	{
+		Parameters parameters;
+		int version;
+	};
+
+	//front (audio thread), middle (shared through mMiddle with the fresh flag), and back (writers) copies
+	Copy mCopies[3] = { { Parameters(), 0 }, { Parameters(), 0 }, { Parameters(), 0 } };
+	int mFront = 0, mBack = 2;
+	Atomic<int> mMiddle = 1;
+
+	//audio thread side (owners force updates with version -1, so audio thread changes count down from -2)
+	int mAudioThreadVersion = -1;
+
+	//writer side
+	Parameters mLatest;
+	int mVersion = 0;
+	mutable SpinLock mWriteLock;
+};
@@ -10,7 +10,7 @@
 
 //==============================================================================
 DlayAudioProcessorEditor::DlayAudioProcessorEditor (DlayAudioProcessor& p, AudioProcessorValueTreeState& apvts)
-    : AudioProcessorEditor (&p), processor (p), valueTreeState(apvts)
+    : AudioProcessorEditor (&p), processor (p), valueTreeState(apvts), mWaveshaperDisplay(p.mVisualiser, p.mFloatChain.mDynamicWaveshaper)
 {
 	//change UI appearance
 	mDelay.setText("Delay", dontSendNotification);
@@ -44,30 +44,85 @@ DlayAudioProcessorEditor::DlayAudioProcessorEditor (DlayAudioProcessor& p, Audio
 	mReleaseLabel.setText("Release", dontSendNotification);
 	mRelease.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
 	mRelease.setTextValueSuffix("ms");
+	mCharacterLabel.setText("Character", dontSendNotification);
+	mCharacter.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mKneeLabel.setText("Knee", dontSendNotification);
+	mKnee.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mKnee.setTextValueSuffix("dB");
+	mLookaheadLabel.setText("Lookahead", dontSendNotification);
+	mLookahead.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mLookahead.setTextValueSuffix("ms");
+	mLowCrossoverLabel.setText("Low Crossover", dontSendNotification);
+	mLowCrossover.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mLowCrossover.setTextValueSuffix("Hz");
+	mHighCrossoverLabel.setText("High Crossover", dontSendNotification);
+	mHighCrossover.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mHighCrossover.setTextValueSuffix("Hz");
+	mLowDriveLabel.setText("Low Drive", dontSendNotification);
+	mLowDrive.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mLowDrive.setTextValueSuffix("%");
+	mHighDriveLabel.setText("High Drive", dontSendNotification);
+	mHighDrive.setTextBoxStyle(Slider::TextBoxRight, false, labelWidth, labelHeight);
+	mHighDrive.setTextValueSuffix("%");
 
 	mAnalogLabel.setText("Analog", dontSendNotification);
+	mCompanderLabel.setText("Compander", dontSendNotification);
+	mNoiseLabel.setText("Noise", dontSendNotification);
+	mStereoLinkLabel.setText("Stereo Link", dontSendNotification);
 
 	mTargetWaveshaperLabel.setText("Target Waveshaper", dontSendNotification);
 	mTargetWaveshaper.setJustificationType(Justification::centred);
+	mTargetWaveshaper.addItem("Linear", linear);
 	mTargetWaveshaper.addItem("BBD", bbd);
 	mTargetWaveshaper.addItem("Tube", chebyshev);
 	mTargetWaveshaper.addItem("Smashed", smashed);
 
+	mAntialiasingLabel.setText("Antialiasing", dontSendNotification);
+	mAntialiasing.setJustificationType(Justification::centred);
+	mAntialiasing.addItem("Off", antialiasingOff);
+	mAntialiasing.addItem("ADAA 1st Order", adaaFirstOrder);
+	mAntialiasing.addItem("ADAA 2nd Order", adaaSecondOrder);
+
+	mDetectorLabel.setText("Detector", dontSendNotification);
+	mDetector.setJustificationType(Justification::centred);
+	mDetector.addItem("Chunk Gate", chunkGate);
+	mDetector.addItem("Peak", peakDetector);
+	mDetector.addItem("RMS", rmsDetector);
+
+	mBandsLabel.setText("Bands", dontSendNotification);
+	mBands.setJustificationType(Justification::centred);
+	mBands.addItem("Off", bandsOff);
+	mBands.addItem("2 Bands", twoBands);
+	mBands.addItem("3 Bands", threeBands);
+
 	//change processing parameters via lambdas
-	mRate.onValueChange = [this] { processor.mEchoProcessor.setRate(mRate.getValue());};
-	mFeedback.onValueChange = [this] { processor.mEchoProcessor.setFeedback (mFeedback.getValue()); };
-	mWet.onValueChange = [this] { processor.mEchoProcessor.setWet( mWet.getValue()); };
+	mRate.onValueChange = [this] { processor.setRate(mRate.getValue()); };
+	mFeedback.onValueChange = [this] { processor.setFeedback (mFeedback.getValue()); };
+	mWet.onValueChange = [this] { processor.setWet( mWet.getValue()); };
 	
-	mCutoff.onValueChange = [this] {processor.mAAfilter.setCutoffFrequencyHz(mCutoff.getValue()); };
-	mResonance.onValueChange = [this] {processor.mAAfilter.setResonance(mResonance.getValue()); };
+	mCutoff.onValueChange = [this] {processor.mFilterCoefficients.setCutoffFrequencyHz(mCutoff.getValue()); };
+	mResonance.onValueChange = [this] {processor.mFilterCoefficients.setResonance(mResonance.getValue()); };
 	
-	mThreshold.onValueChange = [this] {processor.mDynamicWaveshaper.setThreshold(mThreshold.getValue()); };
-	mAttack.onValueChange = [this] {processor.mDynamicWaveshaper.setAttack(mAttack.getValue()); };
-	mRelease.onValueChange = [this] {processor.mDynamicWaveshaper.setRelease(mRelease.getValue()); };
+	mThreshold.onValueChange = [this] {processor.setThreshold(mThreshold.getValue()); };
+	mAttack.onValueChange = [this] {processor.setAttack(mAttack.getValue()); };
+	mRelease.onValueChange = [this] {processor.setRelease(mRelease.getValue()); };
+	mCharacter.onValueChange = [this] {processor.setCharacter(mCharacter.getValue()); };
+	mKnee.onValueChange = [this] {processor.setKnee(mKnee.getValue()); };
+	mLookahead.onValueChange = [this] {processor.setLookahead(mLookahead.getValue()); };
+	mLowCrossover.onValueChange = [this] {processor.setLowCrossover(mLowCrossover.getValue()); };
+	mHighCrossover.onValueChange = [this] {processor.setHighCrossover(mHighCrossover.getValue()); };
+	mLowDrive.onValueChange = [this] {processor.setLowDrive(mLowDrive.getValue()); };
+	mHighDrive.onValueChange = [this] {processor.setHighDrive(mHighDrive.getValue()); };
 
 	mAnalog.onClick = [this] {processor.setAnalog(mAnalog.getToggleState()); };
+	mCompander.onClick = [this] {processor.setCompander(mCompander.getToggleState()); };
+	mNoise.onClick = [this] {processor.setNoise(mNoise.getToggleState()); };
+	mStereoLink.onClick = [this] {processor.setStereoLink(mStereoLink.getToggleState()); };
 
-	mTargetWaveshaper.onChange = [this] {processor.mDynamicWaveshaper.setTargetWaveshaper(mTargetWaveshaper.getSelectedId()); };
+	mTargetWaveshaper.onChange = [this] {processor.setTargetWaveshaper(jmax(0, mTargetWaveshaper.getSelectedId() - linear)); };
+	mAntialiasing.onChange = [this] {processor.setAntialiasing(jmax(0, mAntialiasing.getSelectedId() - antialiasingOff)); };
+	mDetector.onChange = [this] {processor.setDetector(jmax(0, mDetector.getSelectedId() - chunkGate)); };
+	mBands.onChange = [this] {processor.setBands(jmax(1, mBands.getSelectedId() - bandsOff + 1)); };
 
 	//make visible
 	addAndMakeVisible(mDelay);
@@ -91,12 +146,40 @@ DlayAudioProcessorEditor::DlayAudioProcessorEditor (DlayAudioProcessor& p, Audio
 	addAndMakeVisible(mAttack);
 	addAndMakeVisible(mReleaseLabel);
 	addAndMakeVisible(mRelease);
+	addAndMakeVisible(mCharacterLabel);
+	addAndMakeVisible(mCharacter);
+	addAndMakeVisible(mKneeLabel);
+	addAndMakeVisible(mKnee);
+	addAndMakeVisible(mLookaheadLabel);
+	addAndMakeVisible(mLookahead);
+	addAndMakeVisible(mLowCrossoverLabel);
+	addAndMakeVisible(mLowCrossover);
+	addAndMakeVisible(mHighCrossoverLabel);
+	addAndMakeVisible(mHighCrossover);
+	addAndMakeVisible(mLowDriveLabel);
+	addAndMakeVisible(mLowDrive);
+	addAndMakeVisible(mHighDriveLabel);
+	addAndMakeVisible(mHighDrive);
 
 	addAndMakeVisible(mAnalogLabel);
 	addAndMakeVisible(mAnalog);
+	addAndMakeVisible(mCompanderLabel);
+	addAndMakeVisible(mCompander);
+	addAndMakeVisible(mNoiseLabel);
+	addAndMakeVisible(mNoise);
+	addAndMakeVisible(mStereoLinkLabel);
+	addAndMakeVisible(mStereoLink);
 
 	addAndMakeVisible(mTargetWaveshaperLabel);
 	addAndMakeVisible(mTargetWaveshaper);
+	addAndMakeVisible(mAntialiasingLabel);
+	addAndMakeVisible(mAntialiasing);
+	addAndMakeVisible(mDetectorLabel);
+	addAndMakeVisible(mDetector);
+	addAndMakeVisible(mBandsLabel);
+	addAndMakeVisible(mBands);
+
+	addAndMakeVisible(mWaveshaperDisplay);
 
 	//attach after UI elements to ensure attahments are deleted first in editor's destructor 
 	mRateAttachment = std::make_unique<SliderAttachment>(valueTreeState, "rate", mRate);
@@ -109,13 +192,26 @@ DlayAudioProcessorEditor::DlayAudioProcessorEditor (DlayAudioProcessor& p, Audio
 	mThresholdAttachment = std::make_unique<SliderAttachment>(valueTreeState, "threshold", mThreshold);
 	mAttackAttachment = std::make_unique<SliderAttachment>(valueTreeState, "attack", mAttack);
 	mReleaseAttachment = std::make_unique<SliderAttachment>(valueTreeState, "release", mRelease);
+	mCharacterAttachment = std::make_unique<SliderAttachment>(valueTreeState, "character", mCharacter);
+	mKneeAttachment = std::make_unique<SliderAttachment>(valueTreeState, "knee", mKnee);
+	mLookaheadAttachment = std::make_unique<SliderAttachment>(valueTreeState, "lookahead", mLookahead);
+	mLowCrossoverAttachment = std::make_unique<SliderAttachment>(valueTreeState, "lowCrossover", mLowCrossover);
+	mHighCrossoverAttachment = std::make_unique<SliderAttachment>(valueTreeState, "highCrossover", mHighCrossover);
+	mLowDriveAttachment = std::make_unique<SliderAttachment>(valueTreeState, "lowDrive", mLowDrive);
+	mHighDriveAttachment = std::make_unique<SliderAttachment>(valueTreeState, "highDrive", mHighDrive);
 
 	mAnalogAttachment = std::make_unique<ButtonAttachment>(valueTreeState, "analog", mAnalog);
+	mCompanderAttachment = std::make_unique<ButtonAttachment>(valueTreeState, "compander", mCompander);
+	mNoiseAttachment = std::make_unique<ButtonAttachment>(valueTreeState, "noise", mNoise);
+	mStereoLinkAttachment = std::make_unique<ButtonAttachment>(valueTreeState, "stereoLink", mStereoLink);
 
 	mTargetWaveshaperAttachment = std::make_unique<ComboBoxAttachment>(valueTreeState, "targetWaveshaper", mTargetWaveshaper);
+	mAntialiasingAttachment = std::make_unique<ComboBoxAttachment>(valueTreeState, "antialiasing", mAntialiasing);
+	mDetectorAttachment = std::make_unique<ComboBoxAttachment>(valueTreeState, "detector", mDetector);
+	mBandsAttachment = std::make_unique<ComboBoxAttachment>(valueTreeState, "bands", mBands);
 
 	//set Window
-	setSize(600, 320);
+	setSize(600, 520 + displayHeight);
 }
 
 
@@ -164,12 +260,46 @@ void DlayAudioProcessorEditor::resized()
 	mAttack.setBounds(sliderX, 270, sliderWidth, sliderHeight);
 	mReleaseLabel.setBounds(margin, 290, labelWidth, labelHeight);
 	mRelease.setBounds(sliderX, 290, sliderWidth, sliderHeight);
+	mCharacterLabel.setBounds(margin, 310, labelWidth, labelHeight);
+	mCharacter.setBounds(sliderX, 310, sliderWidth, sliderHeight);
+	mAntialiasingLabel.setBounds(margin, 330, labelWidth + 30, labelHeight);
+	mAntialiasing.setBounds(sectionLabelX - 20, 330, sectionLabelWidth + 20, sliderHeight);
+	mDetectorLabel.setBounds(margin, 350, labelWidth + 30, labelHeight);
+	mDetector.setBounds(sectionLabelX - 20, 350, sectionLabelWidth + 20, sliderHeight);
+	mKneeLabel.setBounds(margin, 370, labelWidth, labelHeight);
+	mKnee.setBounds(sliderX, 370, sliderWidth, sliderHeight);
+	mLookaheadLabel.setBounds(margin, 390, labelWidth, labelHeight);
+	mLookahead.setBounds(sliderX, 390, sliderWidth, sliderHeight);
+	mBandsLabel.setBounds(margin, 410, labelWidth + 30, labelHeight);
+	mBands.setBounds(sectionLabelX - 20, 410, sectionLabelWidth + 20, sliderHeight);
+	mLowCrossoverLabel.setBounds(margin, 430, labelWidth, labelHeight);
+	mLowCrossover.setBounds(sliderX, 430, sliderWidth, sliderHeight);
+	mHighCrossoverLabel.setBounds(margin, 450, labelWidth, labelHeight);
+	mHighCrossover.setBounds(sliderX, 450, sliderWidth, sliderHeight);
+	mLowDriveLabel.setBounds(margin, 470, labelWidth, labelHeight);
+	mLowDrive.setBounds(sliderX, 470, sliderWidth, sliderHeight);
+	mHighDriveLabel.setBounds(margin, 490, labelWidth, labelHeight);
+	mHighDrive.setBounds(sliderX, 490, sliderWidth, sliderHeight);
 
 	//Analog On/Off
 	mAnalogLabel.setBounds(getWidth() - margin - labelWidth - buttonWidth, 110, labelWidth, labelHeight);
 	mAnalog.setBounds(getWidth() - margin - buttonWidth, 110, buttonWidth, buttonWidth);
+
+	//Stereo Link On/Off
+	mStereoLinkLabel.setBounds(getWidth() - margin - labelWidth - buttonWidth, 190, labelWidth, labelHeight);
+	mStereoLink.setBounds(getWidth() - margin - buttonWidth, 190, buttonWidth, buttonWidth);
+
+	//Compander On/Off
+	mCompanderLabel.setBounds(getWidth() - margin - labelWidth - buttonWidth, margin, labelWidth, labelHeight);
+	mCompander.setBounds(getWidth() - margin - buttonWidth, margin, buttonWidth, buttonWidth);
+
+	//Noise On/Off
+	mNoiseLabel.setBounds(margin, margin, labelWidth, labelHeight);
+	mNoise.setBounds(margin + labelWidth, margin, buttonWidth, buttonWidth);
+
+	//Transfer function and envelope graph
+	mWaveshaperDisplay.setBounds(margin, 520, getWidth() - 2 * margin, displayHeight - margin);
 }
 
 //TODO make sliders lag and scale appropriately per parameter
-//TODO real time graph of waveshaping transfer function
 //TODO grey out AA filter and DynamicWaveshaper sections when Analog is off
\ No newline at end of file
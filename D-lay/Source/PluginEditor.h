@@ -7,8 +7,9 @@
 
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "WaveshaperDisplay.h"
 
 //==============================================================================
 class DlayAudioProcessorEditor  : public AudioProcessorEditor
@@ -43,31 +44,60 @@ private:
 		labelHeight = 20,
 		sliderX = 100,
 		sliderHeight = 20,
-		buttonWidth = 30
+		buttonWidth = 30,
+		displayHeight = 170
 	};
 
-	//ComboBox indicies
+	//ComboBox indicies (ComboBoxAttachment maps choice index i to item id i + 1)
 	enum
 	{
-		bbd = 1,
-		chebyshev = 2,
-		smashed = 3
+		linear = 1,
+		bbd = 2,
+		chebyshev = 3,
+		smashed = 4
+	};
+
+	//Antialiasing ComboBox item ids
+	enum
+	{
+		antialiasingOff = 1,
+		adaaFirstOrder = 2,
+		adaaSecondOrder = 3
+	};
+
+	//Detector ComboBox item ids
+	enum
+	{
+		chunkGate = 1,
+		peakDetector = 2,
+		rmsDetector = 3
+	};
+
+	//Bands ComboBox item ids
+	enum
+	{
+		bandsOff = 1,
+		twoBands = 2,
+		threeBands = 3
 	};
 
 
 	//labels
 	Label mDelay, mAAfilter, mDynamicWaveshaper;
-	Label mRateLabel, mFeedbackLabel, mWetLabel, mCutoffLabel, mResonanceLabel, mThresholdLabel, mAttackLabel, mReleaseLabel, mAnalogLabel, mTargetWaveshaperLabel;
+	Label mRateLabel, mFeedbackLabel, mWetLabel, mCutoffLabel, mResonanceLabel, mThresholdLabel, mAttackLabel, mReleaseLabel, mCharacterLabel, mAnalogLabel, mCompanderLabel, mNoiseLabel, mTargetWaveshaperLabel, mAntialiasingLabel, mDetectorLabel, mKneeLabel, mStereoLinkLabel, mLookaheadLabel, mBandsLabel, mLowCrossoverLabel, mHighCrossoverLabel, mLowDriveLabel, mHighDriveLabel;
 
 	//UI parameters
-	Slider mRate, mFeedback, mWet, mCutoff, mResonance, mThreshold, mAttack, mRelease;
-	ToggleButton mAnalog;
-	ComboBox mTargetWaveshaper;
+	Slider mRate, mFeedback, mWet, mCutoff, mResonance, mThreshold, mAttack, mRelease, mCharacter, mKnee, mLookahead, mLowCrossover, mHighCrossover, mLowDrive, mHighDrive;
+	ToggleButton mAnalog, mCompander, mNoise, mStereoLink;
+	ComboBox mTargetWaveshaper, mAntialiasing, mDetector, mBands;
+
+	//real time transfer function and envelope graph
+	WaveshaperDisplay mWaveshaperDisplay;
 
 	//parameter attachments
-	std::unique_ptr<SliderAttachment> mRateAttachment, mFeedbackAttachment, mWetAttachment, mCutoffAttachment, mResonanceAttachment, mThresholdAttachment, mAttackAttachment, mReleaseAttachment;
-	std::unique_ptr<ButtonAttachment> mAnalogAttachment;
-	std::unique_ptr<ComboBoxAttachment> mTargetWaveshaperAttachment;
+	std::unique_ptr<SliderAttachment> mRateAttachment, mFeedbackAttachment, mWetAttachment, mCutoffAttachment, mResonanceAttachment, mThresholdAttachment, mAttackAttachment, mReleaseAttachment, mCharacterAttachment, mKneeAttachment, mLookaheadAttachment, mLowCrossoverAttachment, mHighCrossoverAttachment, mLowDriveAttachment, mHighDriveAttachment;
+	std::unique_ptr<ButtonAttachment> mAnalogAttachment, mCompanderAttachment, mNoiseAttachment, mStereoLinkAttachment;
+	std::unique_ptr<ComboBoxAttachment> mTargetWaveshaperAttachment, mAntialiasingAttachment, mDetectorAttachment, mBandsAttachment;
     
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DlayAudioProcessorEditor)
@@ -7,6 +7,15 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "VoiceBankProcessor.h"
+
+namespace
+{
+	//IDs of addParameters in DlayAudioProcessor::Parameter order
+	const char* const parameterIDs[DlayAudioProcessor::numParameters] = {
+		"rate", "feedback", "wet", "cutoff", "resonance", "threshold", "attack", "release", "analog", "compander", "noise", "targetWaveshaper", "character", "antialiasing",
+		"detector", "knee", "stereoLink", "lookahead", "bands", "lowCrossover", "highCrossover", "lowDrive", "highDrive" };
+}
 
 DlayAudioProcessor::DlayAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -14,67 +23,172 @@ DlayAudioProcessor::DlayAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", AudioChannelSet::stereo(), true)
                      #endif
                        ),
-	parameters(*this, nullptr, Identifier("Dlay"),
-		{
-			std::make_unique<AudioParameterFloat>("rate", //ms
-												"Rate",
-												NormalisableRange<float>(0.0f, 1000.0f, 0.01f, 0.25f),
-												150.0f),
-			std::make_unique<AudioParameterFloat>("feedback", //dB
-												"Feedback",
-												-40.0f,
-												0.0f,
-												-15.0f),
-			std::make_unique<AudioParameterInt>("wet", //percent
-												"Wet",
-												0,
-												100,
-												50),
-			std::make_unique<AudioParameterFloat>("cutoff", //Hz
-												"Cutoff",
-												1000.0f,
-												3000.0f,
-												2000.0f),
-			std::make_unique<AudioParameterFloat>("resonance", //[0,1]
-												"Resonance",
-												NormalisableRange<float>(0.0f, 1.0f, 0.001f, 0.25f),
-												0.1f),
-			std::make_unique<AudioParameterFloat>("threshold",//dB
-												"Threshold",
-												-60.0f,
-												0.0f,
-												-30.0f),
-			std::make_unique<AudioParameterFloat>("attack", //ms
-												"Attack",
-												NormalisableRange<float>(0.0f, 500.0f, 0.01f, 0.25f),
-												50.0f),
-			std::make_unique<AudioParameterFloat>("release", //ms
-												"Release",
-												NormalisableRange<float>(0.0f, 1000.0f, 0.01f, 0.25f),
-												100.0f),
-			std::make_unique<AudioParameterBool>("analog", //On/Off
-												"Analog",
-												true),
-			std::make_unique<AudioParameterChoice>("targetWaveshaper", //enum
-												"Target Waveshaper",
-												StringArray({"Linear", "BBD","Tube", "Smashed"}),
-												0)
-		})
+	parameters(*this, nullptr, Identifier("Dlay"), createParameterLayout())
 	
 #endif
 {
 	//set default filter parameters
-	mAAfilter.setCutoffFrequencyHz(2500.0f);
-	mAAfilter.setResonance(0.3f);
-	mAAfilter.setMode(dsp::LadderFilter<float>::Mode::LPF24);
+	mFilterCoefficients.setCutoffFrequencyHz(2500.0f);
+	mFilterCoefficients.setResonance(0.3f);
+
+	//set default noise levels (MN3005 class hiss, clock bleed mostly removed by the reconstruction filter)
+	mNoise.setHissLevel(-80.0f);
+	mNoise.setClockBleedLevel(-90.0f);
+
+	//event targets
+	for (int parameter = 0; parameter < numParameters; ++parameter)
+		mParameterObjects[parameter] = parameters.getParameter(parameterIDs[parameter]);
+
+	//committed events and latency changes
+	startTimerHz(commitRateHz);
 }
 
 DlayAudioProcessor::~DlayAudioProcessor()
 {
+	stopTimer();
+}
+
+AudioProcessorValueTreeState::ParameterLayout DlayAudioProcessor::createParameterLayout()
+{
+	AudioProcessorValueTreeState::ParameterLayout layout;
+	addParameters(layout);
+	return layout;
+}
+
+void DlayAudioProcessor::addParameters(AudioProcessorValueTreeState::ParameterLayout& layout, const String& idSuffix, const String& namePrefix)
+{
+	layout.add(
+		std::make_unique<AudioParameterFloat>("rate" + idSuffix, //ms
+											namePrefix + "Rate",
+											NormalisableRange<float>(0.0f, 1000.0f, 0.01f, 0.25f),
+											150.0f),
+		std::make_unique<AudioParameterFloat>("feedback" + idSuffix, //dB
+											namePrefix + "Feedback",
+											-40.0f,
+											0.0f,
+											-15.0f),
+		std::make_unique<AudioParameterInt>("wet" + idSuffix, //percent
+											namePrefix + "Wet",
+											0,
+											100,
+											50),
+		std::make_unique<AudioParameterFloat>("cutoff" + idSuffix, //Hz
+											namePrefix + "Cutoff",
+											1000.0f,
+											3000.0f,
+											2000.0f),
+		std::make_unique<AudioParameterFloat>("resonance" + idSuffix, //[0,1]
+											namePrefix + "Resonance",
+											NormalisableRange<float>(0.0f, 1.0f, 0.001f, 0.25f),
+											0.1f),
+		std::make_unique<AudioParameterFloat>("threshold" + idSuffix,//dB
+											namePrefix + "Threshold",
+											-60.0f,
+											0.0f,
+											-30.0f),
+		std::make_unique<AudioParameterFloat>("attack" + idSuffix, //ms
+											namePrefix + "Attack",
+											NormalisableRange<float>(0.0f, 500.0f, 0.01f, 0.25f),
+											50.0f),
+		std::make_unique<AudioParameterFloat>("release" + idSuffix, //ms
+											namePrefix + "Release",
+											NormalisableRange<float>(0.0f, 1000.0f, 0.01f, 0.25f),
+											100.0f),
+		std::make_unique<AudioParameterBool>("analog" + idSuffix, //On/Off
+											namePrefix + "Analog",
+											true),
+		std::make_unique<AudioParameterBool>("compander" + idSuffix, //On/Off
+											namePrefix + "Compander",
+											false),
+		std::make_unique<AudioParameterBool>("noise" + idSuffix, //On/Off
+											namePrefix + "Noise",
+											false), //off so sessions saved before Noise existed sound unchanged
+		std::make_unique<AudioParameterChoice>("targetWaveshaper" + idSuffix, //enum
+											namePrefix + "Target Waveshaper",
+											StringArray({"Linear", "BBD","Tube", "Smashed"}),
+											0),
+		std::make_unique<AudioParameterFloat>("character" + idSuffix, //[0,3] morph past the target waveshaper
+											namePrefix + "Character",
+											0.0f,
+											3.0f,
+											0.0f),
+		std::make_unique<AudioParameterChoice>("antialiasing" + idSuffix, //enum
+											namePrefix + "Antialiasing",
+											StringArray({"Off", "ADAA 1st Order", "ADAA 2nd Order"}),
+											0),
+		std::make_unique<AudioParameterChoice>("detector" + idSuffix, //enum
+											namePrefix + "Detector",
+											StringArray({"Chunk Gate", "Peak", "RMS"}),
+											0),
+		std::make_unique<AudioParameterFloat>("knee" + idSuffix, //dB
+											namePrefix + "Knee",
+											NormalisableRange<float>(0.0f, 24.0f, 0.01f),
+											0.0f),
+		std::make_unique<AudioParameterBool>("stereoLink" + idSuffix, //On/Off
+											namePrefix + "Stereo Link",
+											false),
+		std::make_unique<AudioParameterFloat>("lookahead" + idSuffix, //ms
+											namePrefix + "Lookahead",
+											NormalisableRange<float>(0.0f, DynamicWaveshaper<float>::maxLookahead, 0.01f),
+											0.0f),
+		std::make_unique<AudioParameterChoice>("bands" + idSuffix, //enum
+											namePrefix + "Bands",
+											StringArray({"Off", "2 Bands", "3 Bands"}),
+											0),
+		std::make_unique<AudioParameterFloat>("lowCrossover" + idSuffix, //Hz
+											namePrefix + "Low Crossover",
+											NormalisableRange<float>(40.0f, 1000.0f, 0.01f, 0.5f),
+											250.0f),
+		std::make_unique<AudioParameterFloat>("highCrossover" + idSuffix, //Hz
+											namePrefix + "High Crossover",
+											NormalisableRange<float>(1000.0f, 12000.0f, 0.01f, 0.5f),
+											3000.0f),
+		std::make_unique<AudioParameterInt>("lowDrive" + idSuffix, //percent
+											namePrefix + "Low Drive",
+											0,
+											100,
+											100),
+		std::make_unique<AudioParameterInt>("highDrive" + idSuffix, //percent
+											namePrefix + "High Drive",
+											0,
+											100,
+											100));
+}
+
+DlayAudioProcessor::RawParameters DlayAudioProcessor::RawParameters::find(AudioProcessorValueTreeState& state, const String& idSuffix)
+{
+	return { state.getRawParameterValue("rate" + idSuffix), state.getRawParameterValue("feedback" + idSuffix), state.getRawParameterValue("wet" + idSuffix),
+		state.getRawParameterValue("cutoff" + idSuffix), state.getRawParameterValue("resonance" + idSuffix), state.getRawParameterValue("threshold" + idSuffix),
+		state.getRawParameterValue("attack" + idSuffix), state.getRawParameterValue("release" + idSuffix), state.getRawParameterValue("analog" + idSuffix),
+		state.getRawParameterValue("compander" + idSuffix), state.getRawParameterValue("noise" + idSuffix), state.getRawParameterValue("targetWaveshaper" + idSuffix),
+		state.getRawParameterValue("character" + idSuffix), state.getRawParameterValue("antialiasing" + idSuffix),
+		state.getRawParameterValue("detector" + idSuffix), state.getRawParameterValue("knee" + idSuffix), state.getRawParameterValue("stereoLink" + idSuffix),
+		state.getRawParameterValue("lookahead" + idSuffix), state.getRawParameterValue("bands" + idSuffix), state.getRawParameterValue("lowCrossover" + idSuffix),
+		state.getRawParameterValue("highCrossover" + idSuffix), state.getRawParameterValue("lowDrive" + idSuffix), state.getRawParameterValue("highDrive" + idSuffix) };
+}
+
+dlay::Parameters DlayAudioProcessor::RawParameters::toCore() const noexcept
+{
+	dlay::Parameters core;
+	core.rateMs = *rate;
+	core.feedbackDb = *feedback;
+	core.wetPercent = static_cast<float> (roundToInt(*wet));
+	core.cutoffHz = *cutoff;
+	core.resonance = *resonance;
+	core.thresholdDb = *threshold;
+	core.attackMs = *attack;
+	core.releaseMs = *release;
+	core.targetWaveshaper = roundToInt(*targetWaveshaper);
+	core.character = *character;
+	core.analog = *analog >= 0.5f;
+	core.compander = *compander >= 0.5f;
+	core.noise = *noise >= 0.5f;
+	return core;
 }
 
 //==============================================================================
@@ -143,23 +257,71 @@ void DlayAudioProcessor::changeProgramName (int index, const String& newName)
 void DlayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
 	//get environment variables
-	mTotalNumInputChannels = getTotalNumInputChannels();
+	mNumInputChannels = getMainBusNumInputChannels();
 	mTotalNumOutputChannels = getTotalNumOutputChannels();
-	dsp::ProcessSpec spec{ sampleRate, static_cast<uint32>(samplesPerBlock), static_cast<uint32>(mTotalNumInputChannels) };
+	dsp::ProcessSpec spec{ sampleRate, static_cast<uint32>(samplesPerBlock), static_cast<uint32>(mNumInputChannels) };
+
+	//side chain bus channels, when the host enabled it
+	mNumKeyChannels = getBusCount(true) > 1 ? getChannelCountOfBus(true, 1) : 0;
+	mKeyChannelOffset = mNumKeyChannels > 0 ? getChannelIndexInProcessBlockBuffer(true, 1, 0) : 0;
 	
+	//BBD filter coefficients
+	mFilterCoefficients.prepare(sampleRate);
+
+	//only the chain of the host's processing precision is used (the host prepares again if it switches)
+	if (isUsingDoublePrecision())
+		prepareChain(mDoubleChain, spec);
+	else
+		prepareChain(mFloatChain, spec);
+
+	//mNoise
+	mNoise.prepare(spec);
+
+	//mVisualiser
+	mVisualiser.prepare(spec);
+
+#if DLAY_ENABLE_METRICS
+	//mMetrics
+	mMetrics.prepare(sampleRate);
+#endif
+
+	//prepare resets some processors to their defaults
+	applyParameterState();
+}
+
+template <typename SampleType>
+void DlayAudioProcessor::prepareChain(Chain<SampleType>& chain, const dsp::ProcessSpec spec)
+{
 	//mEchoProcessor
-	mEchoProcessor.prepare(spec);
-	
-	//mAAfilter
-	mAAfilter.prepare(spec);
-	
+	chain.mEchoProcessor.prepare(spec);
+
+	//BBD filters
+	chain.mAAfilter.prepare(spec);
+	chain.mReconstructionFilter.prepare(spec);
+
 	//mDynamicWaveshaper
-	mDynamicWaveshaper.prepare(spec);
+	chain.mDynamicWaveshaper.prepare(spec);
+
+	//compander
+	chain.mCompressor.prepare(spec);
+	chain.mExpander.prepare(spec);
+	chain.mWetScratch.setSize(static_cast<int> (spec.numChannels), static_cast<int> (spec.maximumBlockSize));
+
+	//latency compensation
+	chain.mLatencyDelay.prepare(spec, roundToInt(DynamicWaveshaper<SampleType>::maxLookahead * 0.001f * static_cast<float> (spec.sampleRate)));
 }
 
 void DlayAudioProcessor::releaseResources()
 {
-	mAAfilter.reset();
+	mFloatChain.mAAfilter.reset();
+	mFloatChain.mReconstructionFilter.reset();
+	mDoubleChain.mAAfilter.reset();
+	mDoubleChain.mReconstructionFilter.reset();
+	mFloatChain.mCompressor.reset();
+	mFloatChain.mExpander.reset();
+	mDoubleChain.mCompressor.reset();
+	mDoubleChain.mExpander.reset();
+	mNoise.reset();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -175,10 +337,22 @@ bool DlayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
      && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
         return false;
 
+    // The waveshaper packs every channel into one SIMD register, which holds fewest lanes in double precision
+    if (layouts.getMainOutputChannelSet().size() > DynamicWaveshaper<double>::maxChannels)
+        return false;
+
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The side chain bus is optional: disabled, mono, or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto& key = layouts.getChannelSet(true, 1);
+        if (!key.isDisabled() && key != AudioChannelSet::mono() && key != AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -187,22 +361,197 @@ bool DlayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) con
 #endif
 
 void DlayAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+	processChain(mFloatChain, buffer, midiMessages);
+	commitParameterEvents();
+}
+
+void DlayAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+	processChain(mDoubleChain, buffer, midiMessages);
+	commitParameterEvents();
+}
+
+bool DlayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+	return true;
+}
+
+template <typename SampleType>
+void DlayAudioProcessor::processChain(Chain<SampleType>& chain, AudioBuffer<SampleType>& buffer, MidiBuffer& midi) noexcept
 {
 	ScopedNoDenormals noDenormals;
 
 	//clear data
-	for (auto i = mTotalNumInputChannels; i < mTotalNumOutputChannels; ++i)
+	for (auto i = mNumInputChannels; i < mTotalNumOutputChannels; ++i)
 		buffer.clear(i, 0, buffer.getNumSamples());
 
+	//this block's parameter events (queued ones plus MIDI controllers), written back to the value tree from the message thread
+	mEvents.collect(midi, numParameters, buffer.getNumSamples(), [this](int parameter, float normalisedValue) noexcept
+	{
+		return mParameterObjects[parameter]->convertFrom0to1(normalisedValue);
+	});
+
+	//the stages once per run of samples between events, which change the stages' audio thread parameter copies in place
+	DLAY_METRICS_BLOCK(mMetrics, buffer.getNumSamples()); //records each stage once, summed over the runs
+	int startSample = 0;
+	for (int event = 0; event < mEvents.size();)
+	{
+		const int sampleOffset = mEvents[event].sampleOffset;
+		if (sampleOffset > startSample)
+		{
+			processModular(chain, buffer, startSample, sampleOffset - startSample);
+			startSample = sampleOffset;
+		}
+		const AudioThreadChanges changes;
+		for (; event < mEvents.size() && mEvents[event].sampleOffset == sampleOffset; ++event)
+			applyParameter(static_cast<Parameter> (mEvents[event].parameter), mEvents[event].value);
+	}
+	processModular(chain, buffer, startSample, buffer.getNumSamples() - startSample);
+}
+
+template <typename SampleType>
+void DlayAudioProcessor::processModular(Chain<SampleType>& chain, AudioBuffer<SampleType>& block, int runStart, int runLength) noexcept
+{
+	if (runLength <= 0)
+		return;
+
+	//the run as a buffer of its own (referring to the block's channels, so nothing is allocated or copied)
+	AudioBuffer<SampleType> buffer(block.getArrayOfWritePointers(), block.getNumChannels(), runStart, runLength);
+
 	//process
-	mEchoProcessor.fillDelayBuffer(buffer);
+	{
+		DLAY_METRICS_STAGE(mMetrics, fillDelayBuffer);
+		chain.mEchoProcessor.fillDelayBuffer(buffer);
+	}
+	if (mAnalog)
+	{
+		mFilterCoefficients.update(); //once per block for both BBD filters
+		dsp::ProcessContextReplacing<SampleType> writeBlock(*(chain.mEchoProcessor.mWriteBlock));
+		{
+			DLAY_METRICS_STAGE(mMetrics, aaFilter);
+			chain.mAAfilter.process(writeBlock);
+		}
+		{
+			DLAY_METRICS_STAGE(mMetrics, dynamicWaveshaper);
+			//an enabled side chain bus keys the envelope, read straight from the host's channels
+			chain.mDynamicWaveshaper.setExternalKey(buffer.getArrayOfReadPointers() + mKeyChannelOffset, mNumKeyChannels);
+			chain.mDynamicWaveshaper.process(writeBlock); //place after LPF to prevent aliasing from harmonic generation
+		}
+		if (mVisualiser.isActive())
+		{
+			//the main input's level (buffer still holds the dry input here) and every band's envelope, without the side chain bus channels
+			mVisualiser.push(buffer.getArrayOfReadPointers(), mNumInputChannels, chain.mDynamicWaveshaper.getSideChain(),
+				chain.mDynamicWaveshaper.getNumBands(), buffer.getNumSamples());
+		}
+	}
+	else
+	{
+		//bypassed, mDynamicWaveshaper still delays the write path by its Lookahead so echoes keep their place against the delayed dry signal
+		dsp::ProcessContextReplacing<SampleType> writeBlock(*(chain.mEchoProcessor.mWriteBlock));
+		writeBlock.isBypassed = true;
+		chain.mDynamicWaveshaper.process(writeBlock);
+	}
+	mWriteSanitiser.process(*(chain.mEchoProcessor.mWriteBlock)); //a NaN written here would circulate in the delay buffer forever
+	chain.mLatencyDelay.setDelay(chain.mDynamicWaveshaper.getLookaheadSamples());
+	chain.mLatencyDelay.process(dsp::AudioBlock<SampleType>(buffer));
+	{
+		DLAY_METRICS_STAGE(mMetrics, getFromDelayBuffer);
+		if (mAnalog || mCompander || mNoiseOn)
+		{
+			chain.mEchoProcessor.getFromDelayBuffer(buffer, [this, &chain, &buffer](const SampleType* const* source, int numChannels, int startSample, int numSamples, SampleType wet) noexcept
+			{
+				return addWetPath(chain, buffer, source, numChannels, startSample, numSamples, wet);
+			});
+		}
+		else
+		{
+			chain.mEchoProcessor.getFromDelayBuffer(buffer);
+		}
+	}
+	if (mCompander)
+	{
+		//the loop closes through the compander: the write block now holds the input plus the expanded feedback (sanitised by
+		//mEchoProcessor), compressed together as an NE570 delay compresses its input, so every repeat is compressed and expanded exactly
+		//once; the compressed block is not clamped again, as an onset after silence exceeds the clamp until the detector catches up and
+		//the expander restores it
+		dsp::ProcessContextReplacing<SampleType> compressBlock(*(chain.mEchoProcessor.mWriteBlock));
+		chain.mCompressor.process(compressBlock);
+	}
+}
+
+void DlayAudioProcessor::commitParameterEvents() noexcept
+{
+	if (mEvents.size() == 0)
+		return;
+
+	//the last event of each parameter wins
+	bool committed[numParameters] = {};
+	for (int event = mEvents.size() - 1; event >= 0; --event)
+	{
+		const int parameter = mEvents[event].parameter;
+		if (committed[parameter])
+			continue;
+		committed[parameter] = true;
+		mCommitValues[parameter] = mEvents[event].value;
+		++mCommitCounts[parameter];
+	}
+	mEvents.clear();
+}
+
+void DlayAudioProcessor::timerCallback()
+{
+	for (int parameter = 0; parameter < numParameters; ++parameter)
+	{
+		const int count = mCommitCounts[parameter].get();
+		if (count == 0)
+			continue;
+		const float value = mCommitValues[parameter].get();
+		auto* object = mParameterObjects[parameter];
+		object->setValueNotifyingHost(object->convertTo0to1(value));
+		applyParameter(static_cast<Parameter> (parameter), value);
+
+		//a commit from a later block keeps the value pending (the next callback applies it)
+		mCommitCounts[parameter].compareAndSetBool(0, count);
+	}
+	if (mLatencyChanged.compareAndSetBool(0, 1))
+		updateLatency();
+}
+
+template <typename SampleType>
+const SampleType* const* DlayAudioProcessor::addWetPath(Chain<SampleType>& chain, AudioBuffer<SampleType>& buffer, const SampleType* const* source, int numChannels, int startSample, int numSamples, SampleType wet) noexcept
+{
+	//the delay memory recirculates as it is, unless the compander closes the loop after the expander
+	const SampleType* const* loop = source;
+
+	//add noise to and expand a copy of the read segment
+	if (mCompander || mNoiseOn)
+	{
+		for (int channel = 0; channel < numChannels; ++channel)
+			chain.mWetScratch.copyFrom(channel, 0, source[channel], numSamples);
+		dsp::AudioBlock<SampleType> wetBlock = dsp::AudioBlock<SampleType>(chain.mWetScratch).getSubBlock(0, static_cast<size_t> (numSamples));
+		dsp::ProcessContextReplacing<SampleType> wetContext(wetBlock);
+		if (mNoiseOn)
+			mNoise.process(wetContext);
+		if (mCompander)
+		{
+			chain.mExpander.process(wetContext);
+			loop = chain.mWetScratch.getArrayOfReadPointers();
+		}
+		source = chain.mWetScratch.getArrayOfReadPointers();
+	}
+
+	//reconstruction filter fused into the wet mix
 	if (mAnalog)
 	{
-		dsp::ProcessContextReplacing<float> writeBlock(*(mEchoProcessor.mWriteBlock));
-		mAAfilter.process(writeBlock);
-		mDynamicWaveshaper.process(writeBlock); //place after LPF to prevent aliasing from harmonic generation
+		chain.mReconstructionFilter.processAdd(source, buffer.getArrayOfWritePointers(), numChannels, startSample, numSamples, wet);
+	}
+	else
+	{
+		for (int channel = 0; channel < numChannels; ++channel)
+			buffer.addFrom(channel, startSample, source[channel], numSamples, wet);
 	}
-	mEchoProcessor.getFromDelayBuffer(buffer);
+	return loop;
 }
 
 
@@ -220,6 +569,11 @@ AudioProcessorEditor* DlayAudioProcessor::createEditor()
 
 //==============================================================================
 void DlayAudioProcessor::getStateInformation (MemoryBlock& destData)
+{
+	BinaryState::write(*this, destData);
+}
+
+void DlayAudioProcessor::getXmlStateInformation(MemoryBlock& destData)
 {
 	auto state = parameters.copyState();
 	std::unique_ptr<XmlElement> xml(state.createXml());
@@ -228,20 +582,218 @@ void DlayAudioProcessor::getStateInformation (MemoryBlock& destData)
 
 void DlayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+	if (BinaryState::read(*this, data, sizeInBytes))
+	{
+		applyParameterState();
+		return;
+	}
+
+	//legacy value tree XML (states saved before the binary format, and XML presets)
 	std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 	if (xmlState.get() != nullptr)
 		if (xmlState->hasTagName(parameters.state.getType()))
+		{
 			parameters.replaceState(ValueTree::fromXml(*xmlState));
+			applyParameterState();
+		}
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
+#if DLAY_VOICE_BANK
+    return new VoiceBankProcessor();
+#else
     return new DlayAudioProcessor();
+#endif
+}
+
+Sanitiser::Counters DlayAudioProcessor::getFeedbackHealth() const noexcept
+{
+	auto counters = mFloatChain.mEchoProcessor.getFeedbackSanitiser().getCounters();
+	const auto doubleCounters = mDoubleChain.mEchoProcessor.getFeedbackSanitiser().getCounters();
+	counters.nonFinite += doubleCounters.nonFinite;
+	counters.denormals += doubleCounters.denormals;
+	counters.limited += doubleCounters.limited;
+	return counters;
+}
+
+void DlayAudioProcessor::setRate(float msRate) noexcept
+{
+	mFloatChain.mEchoProcessor.setRate(msRate);
+	mDoubleChain.mEchoProcessor.setRate(msRate);
+	mNoise.setRate(msRate);
+}
+
+void DlayAudioProcessor::setFeedback(float dbFeedback) noexcept
+{
+	mFloatChain.mEchoProcessor.setFeedback(dbFeedback);
+	mDoubleChain.mEchoProcessor.setFeedback(dbFeedback);
+}
+
+void DlayAudioProcessor::setWet(int percentWet) noexcept
+{
+	mFloatChain.mEchoProcessor.setWet(percentWet);
+	mDoubleChain.mEchoProcessor.setWet(percentWet);
+}
+
+void DlayAudioProcessor::setThreshold(float dbThreshold) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setThreshold(dbThreshold);
+	mDoubleChain.mDynamicWaveshaper.setThreshold(dbThreshold);
+}
+
+void DlayAudioProcessor::setAttack(float msAttack) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setAttack(msAttack);
+	mDoubleChain.mDynamicWaveshaper.setAttack(msAttack);
+}
+
+void DlayAudioProcessor::setRelease(float msRelease) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setRelease(msRelease);
+	mDoubleChain.mDynamicWaveshaper.setRelease(msRelease);
+}
+
+void DlayAudioProcessor::setTargetWaveshaper(int choice) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setTargetWaveshaper(choice);
+	mDoubleChain.mDynamicWaveshaper.setTargetWaveshaper(choice);
+}
+
+void DlayAudioProcessor::setCharacter(float character) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setCharacter(character);
+	mDoubleChain.mDynamicWaveshaper.setCharacter(character);
+}
+
+void DlayAudioProcessor::setAntialiasing(int order) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setAntialiasing(order);
+	mDoubleChain.mDynamicWaveshaper.setAntialiasing(order);
+}
+
+void DlayAudioProcessor::setDetector(int detector) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setDetector(detector);
+	mDoubleChain.mDynamicWaveshaper.setDetector(detector);
+}
+
+void DlayAudioProcessor::setKnee(float dbKnee) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setKnee(dbKnee);
+	mDoubleChain.mDynamicWaveshaper.setKnee(dbKnee);
+}
+
+void DlayAudioProcessor::setStereoLink(bool onOffStereoLink) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setStereoLink(onOffStereoLink);
+	mDoubleChain.mDynamicWaveshaper.setStereoLink(onOffStereoLink);
+}
+
+void DlayAudioProcessor::setLookahead(float msLookahead) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setLookahead(msLookahead);
+	mDoubleChain.mDynamicWaveshaper.setLookahead(msLookahead);
+
+	//the latency is reported from the message thread (see timerCallback), as events call this on the audio thread
+	mMsLookahead = msLookahead;
+	mLatencyChanged = 1;
+}
+
+void DlayAudioProcessor::updateLatency()
+{
+	//the same rounding as mDynamicWaveshaper (hosts pick a new latency up when they next query it, most on the next prepare)
+	setLatencySamples(roundToInt(mMsLookahead.get() * 0.001f * static_cast<float> (getSampleRate())));
+}
+
+void DlayAudioProcessor::setBands(int numBands) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setBands(numBands);
+	mDoubleChain.mDynamicWaveshaper.setBands(numBands);
+}
+
+void DlayAudioProcessor::setLowCrossover(float hzLowCrossover) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setLowCrossover(hzLowCrossover);
+	mDoubleChain.mDynamicWaveshaper.setLowCrossover(hzLowCrossover);
+}
+
+void DlayAudioProcessor::setHighCrossover(float hzHighCrossover) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setHighCrossover(hzHighCrossover);
+	mDoubleChain.mDynamicWaveshaper.setHighCrossover(hzHighCrossover);
+}
+
+void DlayAudioProcessor::setLowDrive(int percentLowDrive) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setLowDrive(percentLowDrive);
+	mDoubleChain.mDynamicWaveshaper.setLowDrive(percentLowDrive);
+}
+
+void DlayAudioProcessor::setHighDrive(int percentHighDrive) noexcept
+{
+	mFloatChain.mDynamicWaveshaper.setHighDrive(percentHighDrive);
+	mDoubleChain.mDynamicWaveshaper.setHighDrive(percentHighDrive);
 }
 
 void DlayAudioProcessor::setAnalog(bool onOffAnalog) noexcept
 {
 	mAnalog = onOffAnalog;
-}
\ No newline at end of file
+}
+
+void DlayAudioProcessor::setCompander(bool onOffCompander) noexcept
+{
+	mCompander = onOffCompander;
+}
+
+void DlayAudioProcessor::setNoise(bool onOffNoise) noexcept
+{
+	mNoiseOn = onOffNoise;
+}
+
+void DlayAudioProcessor::setCrossfade(float msCrossfade) noexcept
+{
+	mFloatChain.mEchoProcessor.setCrossfade(msCrossfade);
+	mDoubleChain.mEchoProcessor.setCrossfade(msCrossfade);
+	mFloatChain.mDynamicWaveshaper.setCrossfade(msCrossfade);
+	mDoubleChain.mDynamicWaveshaper.setCrossfade(msCrossfade);
+}
+
+void DlayAudioProcessor::applyParameter(Parameter parameter, float value) noexcept
+{
+	switch (parameter)
+	{
+	case Parameter::rate: setRate(value); break;
+	case Parameter::feedback: setFeedback(value); break;
+	case Parameter::wet: setWet(roundToInt(value)); break;
+	case Parameter::cutoff: mFilterCoefficients.setCutoffFrequencyHz(value); break;
+	case Parameter::resonance: mFilterCoefficients.setResonance(value); break;
+	case Parameter::threshold: setThreshold(value); break;
+	case Parameter::attack: setAttack(value); break;
+	case Parameter::release: setRelease(value); break;
+	case Parameter::analog: setAnalog(value >= 0.5f); break;
+	case Parameter::compander: setCompander(value >= 0.5f); break;
+	case Parameter::noise: setNoise(value >= 0.5f); break;
+	case Parameter::targetWaveshaper: setTargetWaveshaper(roundToInt(value)); break;
+	case Parameter::character: setCharacter(value); break;
+	case Parameter::antialiasing: setAntialiasing(roundToInt(value)); break;
+	case Parameter::detector: setDetector(roundToInt(value)); break;
+	case Parameter::knee: setKnee(value); break;
+	case Parameter::stereoLink: setStereoLink(value >= 0.5f); break;
+	case Parameter::lookahead: setLookahead(value); break;
+	case Parameter::bands: setBands(roundToInt(value) + 1); break;
+	case Parameter::lowCrossover: setLowCrossover(value); break;
+	case Parameter::highCrossover: setHighCrossover(value); break;
+	case Parameter::lowDrive: setLowDrive(roundToInt(value)); break;
+	case Parameter::highDrive: setHighDrive(roundToInt(value)); break;
+	}
+}
+
+void DlayAudioProcessor::applyParameterState()
+{
+	for (int parameter = 0; parameter < numParameters; ++parameter)
+		applyParameter(static_cast<Parameter> (parameter), *parameters.getRawParameterValue(parameterIDs[parameter]));
+	updateLatency();
+}
@@ -7,12 +7,23 @@
 
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "DelayLine.h"
 #include "DynamicWaveshaper.h"
+#include "ShortDelay.h"
+#include "BBDFilter.h"
+#include "Compander.h"
+#include "BBDNoise.h"
+#include "Sanitiser.h"
+#include "ProcessMetrics.h"
+#include "VisualiserFifo.h"
+#include "DlayCore.h"
+#include "ParameterEvents.h"
+#include "BinaryState.h"
 
 
-class DlayAudioProcessor  : public AudioProcessor
+class DlayAudioProcessor  : public AudioProcessor,
+                            private Timer
 {
 public:
     //==============================================================================
@@ -25,6 +36,8 @@ public:
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
     //==============================================================================
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -43,29 +56,227 @@ public:
     //==============================================================================
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
+
+	//the value tree state as XML, the format getStateInformation wrote before BinaryState (setStateInformation still reads it)
+	void getXmlStateInformation(MemoryBlock& destData);
+
 	//==============================================================================
 	
-	//DelayLine
-	DelayLine mEchoProcessor;
+	//processing chain for one sample precision: the processor owns a float and a double chain and prepares the one the host processes with
+	template <typename SampleType>
+	struct Chain
+	{
+		explicit Chain(const BBDFilterCoefficients& coefficients) : mAAfilter(coefficients), mReconstructionFilter(coefficients) {}
+
+		//DelayLine
+		DelayLine<SampleType> mEchoProcessor;
+
+		//Resonant low passes: simulate the anti-aliasing filter (write path) and reconstruction filter (wet path) of BBD delays
+		BBDFilter<SampleType> mAAfilter, mReconstructionFilter;
+
+		//DynamicWaveshaper: simulates BBD internal distortion
+		DynamicWaveshaper<SampleType> mDynamicWaveshaper;
+
+		//Compander: NE570 style 2:1 compressor before the delay memory and 1:2 expander on the wet path after it; when on, feedback is
+		//taken after the expander and compressed again with the input
+		Compander<SampleType> mCompressor{ Compander<SampleType>::Mode::compress }, mExpander{ Compander<SampleType>::Mode::expand };
+
+		//noise and expander input, since the delay memory itself must stay untouched
+		AudioBuffer<SampleType> mWetScratch;
+
+		//delays the dry signal by mDynamicWaveshaper's Lookahead
+		ShortDelay<SampleType> mLatencyDelay;
+	};
+
+	//both BBD filter stages of both chains share one coefficient engine so coefficients are computed once per parameter change
+	BBDFilterCoefficients mFilterCoefficients;
+
+	//float and double chains
+	Chain<float> mFloatChain{ mFilterCoefficients };
+	Chain<double> mDoubleChain{ mFilterCoefficients };
+
+	//BBDNoise: hiss and clock bleed of the bucket chain, added to the wet path between compressor and expander (either precision)
+	BBDNoise mNoise;
 
-	//Resonant low pass: simulates anti-aliasing filter and reconstruction filter of BBD delays
-	dsp::LadderFilter<float> mAAfilter;
+	//Sanitiser: keeps non-finite, denormal, and runaway samples from the write path out of the delay memory (either precision)
+	Sanitiser mWriteSanitiser;
 
-	//DynamicWaveshaper: simulates BBD internal distortion
-	DynamicWaveshaper mDynamicWaveshaper;
+	//VisualiserFifo: decimated level and side chain envelope for the editor (only filled while an editor is open)
+	VisualiserFifo mVisualiser;
 
-	//set mAAfilter and mDynamicWaveshaper On/Off
+	//health counters of every sanitised stage (safe to call from any thread)
+	Sanitiser::Counters getWriteHealth() const noexcept { return mWriteSanitiser.getCounters(); }
+	Sanitiser::Counters getFeedbackHealth() const noexcept;
+
+#if DLAY_ENABLE_METRICS
+	//processBlock timing histograms (safe to read from any thread)
+	const ProcessMetrics& getMetrics() const noexcept { return mMetrics; }
+#endif
+
+	//set Rate, Feedback, and Wet of both chains' mEchoProcessor (Rate also clocks mNoise)
+	void setRate(float msRate) noexcept;
+	void setFeedback(float dbFeedback) noexcept;
+	void setWet(int percentWet) noexcept;
+
+	//set Threshold, Attack, Release, Target Waveshaper, Character, Antialiasing, Detector, Knee, and Stereo Link of both chains'
+	//mDynamicWaveshaper
+	void setThreshold(float dbThreshold) noexcept;
+	void setAttack(float msAttack) noexcept;
+	void setRelease(float msRelease) noexcept;
+	void setTargetWaveshaper(int choice) noexcept;
+	void setCharacter(float character) noexcept;
+	void setAntialiasing(int order) noexcept;
+	void setDetector(int detector) noexcept;
+	void setKnee(float dbKnee) noexcept;
+	void setStereoLink(bool onOffStereoLink) noexcept;
+
+	//set Lookahead of both chains' mDynamicWaveshaper using ms value in [0, 10] and report it as latency (from the message thread, see
+	//updateLatency) so hosts compensate it; the dry signal is delayed to match
+	void setLookahead(float msLookahead) noexcept;
+
+	//set Bands (an int in the range [1, 3]), Low Crossover and High Crossover (Hz), and Low Drive and High Drive (percent) of both chains'
+	//mDynamicWaveshaper
+	void setBands(int numBands) noexcept;
+	void setLowCrossover(float hzLowCrossover) noexcept;
+	void setHighCrossover(float hzHighCrossover) noexcept;
+	void setLowDrive(int percentLowDrive) noexcept;
+	void setHighDrive(int percentHighDrive) noexcept;
+
+	//set BBD filters and mDynamicWaveshaper On/Off
 	void setAnalog(bool onOffAnalog) noexcept;
 
+	//set mCompressor and mExpander On/Off
+	void setCompander(bool onOffCompander) noexcept;
+
+	//set mNoise On/Off
+	void setNoise(bool onOffNoise) noexcept;
+
+	//set how long both chains fade between old and new Rate, Feedback, Wet, and Target Waveshaper (parameter changes and presets alike)
+	//using ms value >= 0.0f; 0 switches instantly
+	void setCrossfade(float msCrossfade) noexcept;
+
+	//add the D-lay parameters to layout with IDs "rate" + idSuffix etc. and names namePrefix + "Rate" etc. (shared with VoiceBankProcessor)
+	static void addParameters(AudioProcessorValueTreeState::ParameterLayout& layout, const String& idSuffix = {}, const String& namePrefix = {});
+
+	//parameters in addParameters order: the index of timestamped parameter events (and of its MIDI controller, see ParameterEvents::getParameterForController)
+	enum class Parameter
+	{
+		rate = 0,
+		feedback,
+		wet,
+		cutoff,
+		resonance,
+		threshold,
+		attack,
+		release,
+		analog,
+		compander,
+		noise,
+		targetWaveshaper,
+		character,
+		antialiasing,
+		detector,
+		knee,
+		stereoLink,
+		lookahead,
+		bands,
+		lowCrossover,
+		highCrossover,
+		lowDrive,
+		highDrive
+	};
+	enum { numParameters = 23 };
+
+	//raw value tree parameters of one addParameters set, read by VoiceBankProcessor on the audio thread
+	struct RawParameters
+	{
+		float *rate, *feedback, *wet, *cutoff, *resonance, *threshold, *attack, *release, *analog, *compander, *noise, *targetWaveshaper, *character, *antialiasing, *detector, *knee, *stereoLink, *lookahead, *bands, *lowCrossover,
+			*highCrossover, *lowDrive, *highDrive;
+
+		//look up the set added with idSuffix (message thread, once)
+		static RawParameters find(AudioProcessorValueTreeState& state, const String& idSuffix = {});
+
+		//current values in the units of DlayCore.h (audio thread, once per block)
+		dlay::Parameters toCore() const noexcept;
+	};
+
+	//set parameter to a plain value at sampleOffset of the next processBlock (audio thread, before processBlock); the block is split
+	//there; returns false when full
+	bool addParameterEvent(int sampleOffset, Parameter parameter, float value) noexcept { return mEvents.add(sampleOffset, static_cast<int> (parameter), value); }
+
+	//push one plain parameter value to the modular processors
+	void applyParameter(Parameter parameter, float value) noexcept;
+
+	//push every parameter of the value tree state to the processors (message thread; also done after prepareToPlay and setStateInformation so hosts without an open editor render the saved state), and report its latency
+	void applyParameterState();
+
 private:
-	//enable/disable mAAfilter and mDynamicWaveshaper flag
+	//enable/disable BBD filters and mDynamicWaveshaper flag
 	bool mAnalog = true;
 
+	//enable/disable mCompressor and mExpander flag
+	bool mCompander = false;
+
+	//enable/disable mNoise flag
+	bool mNoiseOn = false;
+
+	//prepare every processor of chain
+	template <typename SampleType>
+	void prepareChain(Chain<SampleType>& chain, const dsp::ProcessSpec spec);
+
+	//run chain over buffer, splitting it at the block's parameter events (processBlock of either precision)
+	template <typename SampleType>
+	void processChain(Chain<SampleType>& chain, AudioBuffer<SampleType>& buffer, MidiBuffer& midi) noexcept;
+
+	//run the modular stages over runLength samples of block from runStart
+	template <typename SampleType>
+	void processModular(Chain<SampleType>& chain, AudioBuffer<SampleType>& block, int runStart, int runLength) noexcept;
+
+	//hand the last value of every parameter the block's events changed to the message thread (see timerCallback) and clear the events
+	void commitParameterEvents() noexcept;
+
+	//write the committed event values to the value tree (so the editor and the host follow) and publish them to the modular stages, whose
+	//audio thread copies the events changed in place, then report the latency of the last Lookahead if it changed (message thread, polled
+	//at commitRateHz so the audio thread only ever stores values and flags)
+	void timerCallback() override;
+	enum { commitRateHz = 30 };
+
+	//report the last Lookahead set as latency (message thread: timerCallback and applyParameterState)
+	void updateLatency();
+
+	//last Lookahead set in ms and whether it changed since the last updateLatency (setLookahead runs on the audio thread for events)
+	Atomic<float> mMsLookahead = 0.0f;
+	Atomic<int> mLatencyChanged = 0;
+
+	//add wet times a delay line read segment into buffer through the enabled wet path stages (noise, expander, reconstruction filter) and
+	//return the segment to feed back: the expanded one (noise included) when the compander is on, so the loop closes through it, else source
+	template <typename SampleType>
+	const SampleType* const* addWetPath(Chain<SampleType>& chain, AudioBuffer<SampleType>& buffer, const SampleType* const* source, int numChannels, int startSample, int numSamples, SampleType wet) noexcept;
+
 	//UI-synced parameters
 	AudioProcessorValueTreeState parameters;
+
+	//the parameter layout of addParameters
+	static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+	//the parameter objects events are committed to (looked up once in the constructor)
+	std::array<RangedAudioParameter*, numParameters> mParameterObjects;
+
+	//timestamped parameter changes of the current block
+	ParameterEvents mEvents;
+
+	//event values waiting for timerCallback, and how often each was committed since (0 once the value tree holds it)
+	std::array<Atomic<float>, numParameters> mCommitValues;
+	std::array<Atomic<int>, numParameters> mCommitCounts;
+
+#if DLAY_ENABLE_METRICS
+	//processBlock timing histograms
+	ProcessMetrics mMetrics;
+#endif
 	
-	//environment variables
-	int mTotalNumInputChannels, mTotalNumOutputChannels;
+	//environment variables (main bus input channels; side chain bus channels and their first channel in processBlock's buffer)
+	int mNumInputChannels, mTotalNumOutputChannels;
+	int mNumKeyChannels = 0, mKeyChannelOffset = 0;
 	
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DlayAudioProcessor)
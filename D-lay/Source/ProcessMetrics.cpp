@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "ProcessMetrics.h"
+
+void ProcessMetrics::prepare(double sampleRate)
+{
+	//save block deadline variables
+	mTicksPerSample = static_cast<double> (Time::getHighResolutionTicksPerSecond()) / sampleRate;
+	mDeadlineNumSamples = 0;
+	mDeadlineTicks = 0;
+	std::fill(std::begin(mBlockTicks), std::end(mBlockTicks), 0);
+	std::fill(std::begin(mBlockStages), std::end(mBlockStages), false);
+
+	//clear histograms and counters
+	for (auto& histogram : mHistograms)
+	{
+		for (auto& bucket : histogram.buckets)
+			bucket.store(0, std::memory_order_relaxed);
+		histogram.count.store(0, std::memory_order_relaxed);
+		histogram.maxTicks.store(0, std::memory_order_relaxed);
+	}
+	mXrunRisk.store(0, std::memory_order_relaxed);
+	mXruns.store(0, std::memory_order_relaxed);
+}
+
+ProcessMetrics::Summary ProcessMetrics::getSummary(Stage stage) const noexcept
+{
+	const auto& histogram = mHistograms[stage];
+	const auto toMicroseconds = [](int64 ticks) { return Time::highResolutionTicksToSeconds(ticks) * 1.0e6; };
+
+	//copy buckets once so percentiles are computed from one (possibly slightly stale) view
+	uint32 buckets[numBuckets];
+	int64 count = 0;
+	for (int i = 0; i < numBuckets; ++i)
+	{
+		buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+		count += buckets[i];
+	}
+
+	Summary summary;
+	summary.count = count;
+	summary.max = toMicroseconds(histogram.maxTicks.load(std::memory_order_relaxed));
+	if (count == 0)
+		return summary;
+
+	//walk cumulative counts and report the middle of the bucket each percentile falls in
+	const int64 p50Rank = (count + 1) / 2, p99Rank = jmax(static_cast<int64> (1), (count * 99 + 99) / 100);
+	int64 cumulative = 0;
+	bool p50Found = false;
+	for (int i = 0; i < numBuckets; ++i)
+	{
+		cumulative += buckets[i];
+		const double middle = toMicroseconds(getBucketStart(i) + getBucketStart(i + 1)) * 0.5;
+		if (!p50Found && cumulative >= p50Rank)
+		{
+			summary.p50 = middle;
+			p50Found = true;
+		}
+		if (cumulative >= p99Rank)
+		{
+			summary.p99 = middle;
+			break;
+		}
+	}
+	return summary;
+}
+
+String ProcessMetrics::toJSON() const
+{
+	DynamicObject::Ptr stages = new DynamicObject();
+	for (int i = 0; i < numStages; ++i)
+	{
+		const auto summary = getSummary(static_cast<Stage> (i));
+		DynamicObject::Ptr stage = new DynamicObject();
+		stage->setProperty("count", summary.count);
+		stage->setProperty("p50_us", summary.p50);
+		stage->setProperty("p99_us", summary.p99);
+		stage->setProperty("max_us", summary.max);
+		stages->setProperty(getStageName(static_cast<Stage> (i)), var(stage.get()));
+	}
+
+	DynamicObject::Ptr root = new DynamicObject();
+	root->setProperty("stages", var(stages.get()));
+	root->setProperty("xrun_risk_blocks", getXrunRiskCount());
+	root->setProperty("xrun_blocks", getXrunCount());
+	return JSON::toString(var(root.get()));
+}
+
+const char* ProcessMetrics::getStageName(Stage stage) noexcept
+{
+	switch (stage)
+	{
+	case total: return "processBlock";
+	case fillDelayBuffer: return "fillDelayBuffer";
+	case aaFilter: return "aaFilter";
+	case dynamicWaveshaper: return "dynamicWaveshaper";
+	case getFromDelayBuffer: return "getFromDelayBuffer";
+	default: return "unknown";
+	}
+}
+
+int64 ProcessMetrics::getBucketStart(int bucket) noexcept
+{
+	if (bucket < 4)
+		return bucket;
+	const int octave = (bucket - 4) / 4;
+	return static_cast<int64> (4 + (bucket - 4) % 4) << jmin(octave, 60); //past the last reachable bucket
+}
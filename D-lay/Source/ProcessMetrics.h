@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//set to 1 to time processBlock and its stages (compiled out entirely by default)
+#ifndef DLAY_ENABLE_METRICS
+ #define DLAY_ENABLE_METRICS 0
+#endif
+
+//Lock-free timing histograms of processBlock stages: written only by the audio thread, read from any other thread
+class ProcessMetrics
+{
+public:
+
+	//timed stages of DlayAudioProcessor::processBlock
+	enum Stage
+	{
+		total = 0,
+		fillDelayBuffer,
+		aaFilter,
+		dynamicWaveshaper,
+		getFromDelayBuffer,
+		numStages
+	};
+
+	//percentiles of one stage in microseconds (bucket resolution is a quarter octave)
+	struct Summary
+	{
+		int64 count = 0;
+		double p50 = 0.0, p99 = 0.0, max = 0.0;
+	};
+
+	// Essential Methods
+	//==============================================================================
+
+	//save sample rate for block deadlines and clear all histograms
+	void prepare(double sampleRate);
+
+	//add a stage duration in high resolution ticks
+	void record(Stage stage, int64 ticks) noexcept
+	{
+		auto& histogram = mHistograms[stage];
+		increment(histogram.buckets[getBucket(ticks)]);
+		increment(histogram.count);
+		if (ticks > histogram.maxTicks.load(std::memory_order_relaxed)) //single writer, so no compare-and-swap needed
+			histogram.maxTicks.store(ticks, std::memory_order_relaxed);
+	}
+
+	//add a stage duration to the current block's total for that stage (a stage runs once per run of samples between parameter events)
+	void accumulate(Stage stage, int64 ticks) noexcept
+	{
+		mBlockTicks[stage] += ticks;
+		mBlockStages[stage] = true;
+	}
+
+	//add a whole block duration and compare it against the block's real time deadline, then record each stage's total over the block
+	void recordBlock(int64 ticks, int numSamples) noexcept
+	{
+		record(total, ticks);
+		for (int stage = total + 1; stage < numStages; ++stage)
+		{
+			if (mBlockStages[stage])
+				record(static_cast<Stage> (stage), mBlockTicks[stage]);
+			mBlockTicks[stage] = 0;
+			mBlockStages[stage] = false;
+		}
+		if (numSamples != mDeadlineNumSamples)
+		{
+			mDeadlineNumSamples = numSamples;
+			mDeadlineTicks = static_cast<int64> (numSamples * mTicksPerSample);
+		}
+		if (ticks * 2 > mDeadlineTicks)
+			increment(mXrunRisk);
+		if (ticks > mDeadlineTicks)
+			increment(mXruns);
+	}
+
+	// Monitoring (safe to call from any thread)
+	//==============================================================================
+
+	//get percentiles of a stage
+	Summary getSummary(Stage stage) const noexcept;
+
+	//number of blocks that used more than half of / all of their deadline
+	int64 getXrunRiskCount() const noexcept { return mXrunRisk.load(std::memory_order_relaxed); }
+	int64 getXrunCount() const noexcept { return mXruns.load(std::memory_order_relaxed); }
+
+	//dump every stage summary and deadline counter as a JSON object
+	String toJSON() const;
+
+	//name of a stage as used in toJSON
+	static const char* getStageName(Stage stage) noexcept;
+
+	// Scoped Timers
+	//==============================================================================
+
+	//add a stage's duration to the block's total on destruction (recorded by the enclosing ScopedBlockTimer)
+	struct ScopedStageTimer
+	{
+		ScopedStageTimer(ProcessMetrics& m, Stage s) noexcept : metrics(m), stage(s), start(Time::getHighResolutionTicks()) {}
+		~ScopedStageTimer() noexcept { metrics.accumulate(stage, Time::getHighResolutionTicks() - start); }
+
+		ProcessMetrics& metrics;
+		const Stage stage;
+		const int64 start;
+	};
+
+	//record a whole block's duration and its stages' totals on destruction
+	struct ScopedBlockTimer
+	{
+		ScopedBlockTimer(ProcessMetrics& m, int n) noexcept : metrics(m), numSamples(n), start(Time::getHighResolutionTicks()) {}
+		~ScopedBlockTimer() noexcept { metrics.recordBlock(Time::getHighResolutionTicks() - start, numSamples); }
+
+		ProcessMetrics& metrics;
+		const int numSamples;
+		const int64 start;
+	};
+
+private:
+
+	//four buckets per octave of ticks: exact below 4 ticks, then [4,5,6,7] << octave
+	enum { numBuckets = 256 };
+
+	static int getBucket(int64 ticks) noexcept
+	{
+		auto value = static_cast<uint64> (jmax(ticks, static_cast<int64> (0)));
+		if (value < 4)
+			return static_cast<int> (value);
+		int highestBit = 0;
+		for (auto v = value; v >>= 1;)
+			++highestBit;
+		return 4 + (highestBit - 2) * 4 + static_cast<int> ((value >> (highestBit - 2)) & 3);
+	}
+
+	//lower edge of a bucket in ticks
+	static int64 getBucketStart(int bucket) noexcept;
+
+	//add one from the single writer: a relaxed load and store, so no locked read-modify-write on the audio thread (readers only
+	//need each counter to be untorn, not ordered against the others)
+	template <typename Type>
+	static void increment(std::atomic<Type>& counter) noexcept { counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+	struct Histogram
+	{
+		std::atomic<uint32> buckets[numBuckets] = {};
+		std::atomic<int64> count{ 0 }, maxTicks{ 0 };
+	};
+
+	Histogram mHistograms[numStages];
+
+	//stage totals of the current block (audio thread only)
+	int64 mBlockTicks[numStages] = {};
+	bool mBlockStages[numStages] = {};
+
+	//block deadline variables (audio thread only)
+	double mTicksPerSample = 0.0;
+	int mDeadlineNumSamples = 0;
+	int64 mDeadlineTicks = 0;
+
+	//blocks over half of / over their deadline
+	std::atomic<int64> mXrunRisk{ 0 }, mXruns{ 0 };
+};
+
+//time the enclosing scope as a processBlock stage
+#if DLAY_ENABLE_METRICS
+ #define DLAY_METRICS_STAGE(metrics, stage) const ProcessMetrics::ScopedStageTimer JUCE_JOIN_MACRO(metricsStage, __LINE__) (metrics, ProcessMetrics::stage)
+ #define DLAY_METRICS_BLOCK(metrics, numSamples) const ProcessMetrics::ScopedBlockTimer JUCE_JOIN_MACRO(metricsBlock, __LINE__) (metrics, numSamples)
+#else
+ #define DLAY_METRICS_STAGE(metrics, stage)
+ #define DLAY_METRICS_BLOCK(metrics, numSamples)
+#endif
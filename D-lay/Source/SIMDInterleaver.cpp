@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "SIMDInterleaver.h"
+
+#if JUCE_USE_SIMD
+template <typename SampleType>
+void SIMDInterleaver<SampleType>::prepare(int numChannels, int blockSize)
+{
+	mNumGroups = (numChannels + lanes - 1) / lanes;
+	mInterleaved = dsp::AudioBlock<Vec>(interleavedBlockData, static_cast<size_t> (mNumGroups), static_cast<size_t> (blockSize));
+	mZero = dsp::AudioBlock<SampleType>(zeroData, 1, static_cast<size_t> (blockSize));
+	mZero.clear();
+	mBlockPointers.calloc(static_cast<size_t> (jmax(1, numChannels)));
+}
+
+template class SIMDInterleaver<float>;
+template class SIMDInterleaver<double>;
+#endif
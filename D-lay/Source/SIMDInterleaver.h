@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_USE_SIMD
+//Packs channels into SIMD lanes, one group of SIMDRegister<SampleType>::size() channels per interleaved scratch channel, and back
+template <typename SampleType>
+class SIMDInterleaver
+{
+public:
+
+	using Vec = dsp::SIMDRegister<SampleType>;
+	static constexpr int lanes = static_cast<int> (Vec::size());
+
+	// Essential Methods
+	//==============================================================================
+
+	//allocate scratch for numChannels (rounded up to whole groups) of blockSize samples
+	void prepare(int numChannels, int blockSize);
+
+	//number of SIMD groups needed for the prepared channel count
+	int getNumGroups() const noexcept { return mNumGroups; }
+
+	//interleave numSamples of a group of channels into its scratch (lanes past numChannels read zeros) and return the scratch
+	Vec* interleave(int group, const SampleType* const* channels, int numChannels, int numSamples) noexcept
+	{
+		auto* pointers = mChannelPointers.getData();
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			const int channel = group * lanes + lane;
+			pointers[lane] = (channel < numChannels) ? channels[channel] : mZero.getChannelPointer(0);
+		}
+		auto* interleaved = mInterleaved.getChannelPointer(static_cast<size_t> (group));
+		auto* dest = reinterpret_cast<SampleType*> (interleaved);
+		for (int lane = 0; lane < lanes; ++lane)
+			for (int i = 0; i < numSamples; ++i)
+				dest[i * lanes + lane] = pointers[lane][i];
+		return interleaved;
+	}
+
+	//interleave a group of an AudioBlock's channels
+	template <typename BlockType>
+	Vec* interleave(int group, const BlockType& block) noexcept
+	{
+		const int numChannels = static_cast<int> (block.getNumChannels());
+		for (int channel = group * lanes; channel < jmin(numChannels, (group + 1) * lanes); ++channel)
+			mBlockPointers[channel] = block.getChannelPointer(static_cast<size_t> (channel));
+		return interleave(group, mBlockPointers.getData(), numChannels, static_cast<int> (block.getNumSamples()));
+	}
+
+	//deinterleave a group's scratch into channels (padded lanes are discarded)
+	void deinterleave(int group, SampleType* const* channels, int numChannels, int numSamples) noexcept
+	{
+		const auto* source = reinterpret_cast<const SampleType*> (mInterleaved.getChannelPointer(static_cast<size_t> (group)));
+		const int groupChannels = jmin(lanes, numChannels - group * lanes);
+		for (int lane = 0; lane < groupChannels; ++lane)
+		{
+			SampleType* out = channels[group * lanes + lane];
+			for (int i = 0; i < numSamples; ++i)
+				out[i] = source[i * lanes + lane];
+		}
+	}
+
+	//deinterleave a group's scratch into an AudioBlock's channels
+	template <typename BlockType>
+	void deinterleave(int group, const BlockType& block) noexcept
+	{
+		const int numChannels = static_cast<int> (block.getNumChannels());
+		for (int channel = group * lanes; channel < jmin(numChannels, (group + 1) * lanes); ++channel)
+			mBlockPointers[channel] = block.getChannelPointer(static_cast<size_t> (channel));
+		deinterleave(group, const_cast<SampleType* const*> (mBlockPointers.getData()), numChannels, static_cast<int> (block.getNumSamples()));
+	}
+
+	//add gain times a group's scratch into channels starting at startSample, deinterleaving on the fly
+	void deinterleaveAdd(int group, SampleType* const* channels, int numChannels, int startSample, int numSamples, SampleType gain) noexcept
+	{
+		const auto* interleaved = reinterpret_cast<const SampleType*> (mInterleaved.getChannelPointer(static_cast<size_t> (group)));
+		const int groupChannels = jmin(lanes, numChannels - group * lanes);
+		for (int lane = 0; lane < groupChannels; ++lane)
+		{
+			SampleType* out = channels[group * lanes + lane] + startSample;
+			for (int i = 0; i < numSamples; ++i)
+				out[i] += gain * interleaved[i * lanes + lane];
+		}
+	}
+
+private:
+
+	//interleaved scratch, one SIMD channel per group
+	dsp::AudioBlock<Vec> mInterleaved;
+	//zero source for padded lanes
+	dsp::AudioBlock<SampleType> mZero;
+	HeapBlock<char> interleavedBlockData, zeroData;
+	//per group lane pointers and per channel block pointers
+	HeapBlock<const SampleType*> mChannelPointers{ static_cast<size_t> (lanes) };
+	HeapBlock<const SampleType*> mBlockPointers;
+	int mNumGroups = 0;
+};
+#endif
@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "Sanitiser.h"
+
+Sanitiser::Counters Sanitiser::getCounters() const noexcept
+{
+	Counters counters;
+	counters.nonFinite = mNonFinite.get();
+	counters.denormals = mDenormals.get();
+	counters.limited = mLimited.get();
+	return counters;
+}
+
+void Sanitiser::resetCounters() noexcept
+{
+	mNonFinite = 0;
+	mDenormals = 0;
+	mLimited = 0;
+}
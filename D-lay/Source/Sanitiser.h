@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Health stage for recursive paths: replaces non-finite samples with silence, flushes near-denormal samples to zero, and clamps runaway samples
+class Sanitiser
+{
+public:
+
+	//snapshot of how many samples each guard has fixed since the last reset
+	struct Counters
+	{
+		int64 nonFinite = 0, denormals = 0, limited = 0;
+	};
+
+	// Essential Methods
+	//==============================================================================
+
+	//sanitise block in place and update health counters (once per block, only when a guard fired)
+	template <typename SampleType>
+	void process(const dsp::AudioBlock<SampleType>& block) noexcept
+	{
+		int nonFinite = 0, denormals = 0, limited = 0;
+		for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+		{
+			SampleType* data = block.getChannelPointer(channel);
+			const int numSamples = static_cast<int> (block.getNumSamples());
+			int i = 0;
+#if JUCE_USE_SIMD
+			using Vec = dsp::SIMDRegister<SampleType>;
+			const Vec ONE = static_cast<SampleType> (1), ZERO = static_cast<SampleType> (0), FLUSH = static_cast<SampleType> (flushThreshold),
+				LIMIT = static_cast<SampleType> (limit), NEGATIVE_LIMIT = static_cast<SampleType> (-limit);
+			//scalar head up to the first SIMD aligned sample (mWriteBlock starts at arbitrary write positions)
+			const int head = jmin(numSamples, static_cast<int> (Vec::getNextSIMDAlignedPtr(data) - data));
+			for (; i < head; ++i)
+				data[i] = sanitiseSample(data[i], nonFinite, denormals, limited);
+			//vectorised body
+			Vec nonFiniteLanes = ZERO, denormalLanes = ZERO, limitedLanes = ZERO;
+			for (; i + static_cast<int> (Vec::size()) <= numSamples; i += static_cast<int> (Vec::size()))
+			{
+				auto x = Vec::fromRawArray(data + i);
+				//inf * 0 and NaN * 0 are both NaN, and NaN never compares equal
+				auto nonFiniteMask = Vec::notEqual(x * ZERO, ZERO);
+				x = x & (~nonFiniteMask);
+				auto magnitude = Vec::abs(x);
+				auto denormalMask = Vec::greaterThan(FLUSH, magnitude) & Vec::notEqual(magnitude, ZERO);
+				x = x & (~denormalMask);
+				auto limitedMask = Vec::greaterThan(magnitude, LIMIT);
+				x = Vec::max(Vec::min(x, LIMIT), NEGATIVE_LIMIT);
+				x.copyToRawArray(data + i);
+				nonFiniteLanes += ONE & nonFiniteMask;
+				denormalLanes += ONE & denormalMask;
+				limitedLanes += ONE & limitedMask;
+			}
+			nonFinite += static_cast<int> (nonFiniteLanes.sum());
+			denormals += static_cast<int> (denormalLanes.sum());
+			limited += static_cast<int> (limitedLanes.sum());
+#endif
+			//scalar tail (or whole block without SIMD)
+			for (; i < numSamples; ++i)
+				data[i] = sanitiseSample(data[i], nonFinite, denormals, limited);
+		}
+		//touch shared counters only when something happened so healthy blocks stay free of atomic traffic
+		if (nonFinite != 0)
+			mNonFinite += nonFinite;
+		if (denormals != 0)
+			mDenormals += denormals;
+		if (limited != 0)
+			mLimited += limited;
+	}
+
+	// Monitoring (safe to call from any thread)
+	//==============================================================================
+
+	//get current health counters
+	Counters getCounters() const noexcept;
+
+	//zero health counters
+	void resetCounters() noexcept;
+
+	//largest magnitude allowed through (+12dB), well above nominal level so only runaway feedback is clamped
+	static constexpr float limit = 4.0f;
+
+	//magnitudes below this (-300dB) are flushed before they decay into denormals
+	static constexpr float flushThreshold = 1.0e-15f;
+
+private:
+
+	template <typename SampleType>
+	static SampleType sanitiseSample(SampleType x, int& nonFinite, int& denormals, int& limited) noexcept
+	{
+		if (!std::isfinite(x)) { ++nonFinite; return 0; }
+		const SampleType magnitude = std::abs(x);
+		if (magnitude < flushThreshold && magnitude != 0) { ++denormals; return 0; }
+		if (magnitude > limit) { ++limited; return std::copysign(static_cast<SampleType> (limit), x); }
+		return x;
+	}
+
+	//number of samples fixed by each guard, written by the audio thread and read by monitors
+	Atomic<int64> mNonFinite = 0, mDenormals = 0, mLimited = 0;
+};
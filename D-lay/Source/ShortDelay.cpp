@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "ShortDelay.h"
+
+template <typename SampleType>
+void ShortDelay<SampleType>::prepare(const dsp::ProcessSpec spec, int maxDelaySamples)
+{
+	//save spec
+	mBlockSize = static_cast<int> (spec.maximumBlockSize);
+	mNumChannels = static_cast<int> (spec.numChannels);
+
+	//start from silence so renders are repeatable
+	mMaxDelay = jmax(0, maxDelaySamples);
+	mBufferLength = mMaxDelay + mBlockSize;
+	mBuffer.setSize(mNumChannels, mBufferLength);
+	mBuffer.clear();
+	mWritePosition = mDelay = 0;
+}
+
+template <typename SampleType>
+void ShortDelay<SampleType>::reset() noexcept
+{
+	mBuffer.clear();
+}
+
+template <typename SampleType>
+void ShortDelay<SampleType>::setDelay(int delaySamples) noexcept
+{
+	jassert(delaySamples >= 0 && delaySamples <= mMaxDelay);
+	delaySamples = jlimit(0, mMaxDelay, delaySamples);
+	if (mDelay == 0 && delaySamples > 0)
+		mBuffer.clear();
+	mDelay = delaySamples;
+}
+
+template class ShortDelay<float>;
+template class ShortDelay<double>;
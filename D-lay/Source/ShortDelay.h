@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Plain delay of up to a few ms for look-ahead and latency compensation: the same block-wise circular buffer as DelayLine's mDelayBuffer
+//(one copy per segment, two when the buffer wraps around) without feedback or wet mix, sized once in prepare so changing the delay never
+//allocates and costs the same whatever its length
+template <typename SampleType>
+class ShortDelay
+{
+public:
+
+	// Essential Methods
+	//==============================================================================
+
+	//save environment variables and allocate for delays up to maxDelaySamples (starts from silence with no delay)
+	void prepare(const dsp::ProcessSpec spec, int maxDelaySamples);
+
+	//clear the buffer, so the current delay restarts from silence
+	void reset() noexcept;
+
+	//delay every channel of block in place by the current delay (nothing to do at 0)
+	template <typename BlockType>
+	void process(const BlockType& block) noexcept
+	{
+		if (mDelay == 0)
+			return;
+		const int numSamples = static_cast<int> (block.getNumSamples());
+		jassert(numSamples <= mBlockSize);
+		const int readPosition = (mBufferLength + mWritePosition - mDelay) % mBufferLength;
+		for (int channel = 0; channel < jmin(mNumChannels, static_cast<int> (block.getNumChannels())); ++channel)
+		{
+			SampleType* audio = block.getChannelPointer(static_cast<size_t> (channel));
+
+			//write, then read (a delay shorter than the block reads some of what was just written)
+			const int firstWrite = jmin(numSamples, mBufferLength - mWritePosition);
+			mBuffer.copyFrom(channel, mWritePosition, audio, firstWrite);
+			if (numSamples > firstWrite)
+				mBuffer.copyFrom(channel, 0, audio + firstWrite, numSamples - firstWrite);
+			const int firstRead = jmin(numSamples, mBufferLength - readPosition);
+			FloatVectorOperations::copy(audio, mBuffer.getReadPointer(channel, readPosition), firstRead);
+			if (numSamples > firstRead)
+				FloatVectorOperations::copy(audio + firstRead, mBuffer.getReadPointer(channel), numSamples - firstRead);
+		}
+		mWritePosition = (mWritePosition + numSamples) % mBufferLength;
+	}
+
+	// Parameters
+	//==============================================================================
+
+	//set the delay using samples in [0, maxDelaySamples] (audio thread); switching on from 0 restarts from silence rather than old audio
+	void setDelay(int delaySamples) noexcept;
+
+	//get the current delay in samples
+	int getDelay() const noexcept { return mDelay; }
+
+private:
+
+	//circular buffer of the longest delay plus one block, so a block never overwrites samples it still has to read
+	AudioBuffer<SampleType> mBuffer;
+	int mBufferLength = 0, mWritePosition = 0, mDelay = 0, mMaxDelay = 0;
+
+	//environment variables
+	int mBlockSize = 0, mNumChannels = 0;
+};
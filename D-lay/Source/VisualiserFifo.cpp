@@ -0,0 +1,34 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "VisualiserFifo.h"
+
+void VisualiserFifo::prepare(const dsp::ProcessSpec spec)
+{
+	//one frame per millisecond
+	mDecimation = jmax(1, static_cast<int> (spec.sampleRate / 1000.0));
+	mFrameRate = spec.sampleRate / mDecimation;
+
+	//worst case number of frames in one block
+	mBlockFrames.allocate(static_cast<size_t> ((spec.maximumBlockSize + mDecimation - 1) / mDecimation), false);
+	mFifo.reset();
+}
+
+int VisualiserFifo::pull(Frame* dest, int maxFrames) noexcept
+{
+	int start1, size1, start2, size2;
+	mFifo.prepareToRead(maxFrames, start1, size1, start2, size2);
+	if (size1 > 0)
+		memcpy(dest, mFrames.getData() + start1, static_cast<size_t> (size1) * sizeof(Frame));
+	if (size2 > 0)
+		memcpy(dest + size1, mFrames.getData() + start2, static_cast<size_t> (size2) * sizeof(Frame));
+	mFifo.finishedRead(size1 + size2);
+	return size1 + size2;
+}
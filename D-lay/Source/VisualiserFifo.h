@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Wait-free single producer (audio thread), single consumer (message thread) ring of decimated level and envelope frames
+class VisualiserFifo
+{
+public:
+
+	//one decimation window: peak input level and side chain envelope across channels (and bands)
+	struct Frame
+	{
+		float level, envelope;
+	};
+
+	// Essential Methods
+	//==============================================================================
+
+	//save decimation and allocate per block frame storage
+	void prepare(const dsp::ProcessSpec spec);
+
+	//decimate and push a block of frames (audio thread, only while active): the level of numChannels input channels (the main bus, not a
+	//side chain) and the envelope of numBands bands of as many channels (envelope channel band * numChannels + channel, see
+	//DynamicWaveshaper::getSideChain), so every band counts towards the broadband envelope; drops frames if the consumer falls behind
+	template <typename SampleType>
+	void push(const SampleType* const* input, int numChannels, const AudioBuffer<SampleType>& envelope, int numBands, int numSamples) noexcept
+	{
+		//decimate into mBlockFrames
+		const int numEnvelopeChannels = jmin(numBands * numChannels, envelope.getNumChannels());
+		int numFrames = 0;
+		for (int start = 0; start < numSamples; start += mDecimation, ++numFrames)
+		{
+			const int length = jmin(mDecimation, numSamples - start);
+			Frame frame{ 0.0f, 0.0f };
+			for (int channel = 0; channel < numChannels; ++channel)
+			{
+				const auto range = FloatVectorOperations::findMinAndMax(input[channel] + start, length);
+				frame.level = jmax(frame.level, static_cast<float> (range.getEnd()), static_cast<float> (-range.getStart()));
+			}
+			for (int channel = 0; channel < numEnvelopeChannels; ++channel)
+				frame.envelope = jmax(frame.envelope, static_cast<float> (envelope.getSample(channel, start + length - 1)));
+			mBlockFrames[numFrames] = frame;
+		}
+
+		//bounded memcpy into the ring
+		int start1, size1, start2, size2;
+		mFifo.prepareToWrite(numFrames, start1, size1, start2, size2);
+		if (size1 > 0)
+			memcpy(mFrames.getData() + start1, mBlockFrames.getData(), static_cast<size_t> (size1) * sizeof(Frame));
+		if (size2 > 0)
+			memcpy(mFrames.getData() + start2, mBlockFrames.getData() + size1, static_cast<size_t> (size2) * sizeof(Frame));
+		mFifo.finishedWrite(size1 + size2);
+	}
+
+	//copy up to maxFrames of the oldest frames to dest and return how many were copied (message thread)
+	int pull(Frame* dest, int maxFrames) noexcept;
+
+	//push is skipped by the processor unless a consumer is active
+	void setActive(bool active) noexcept { mActive = active ? 1 : 0; }
+	bool isActive() const noexcept { return mActive.get() != 0; }
+
+	//frames per second produced by push
+	double getFrameRate() const noexcept { return mFrameRate; }
+
+	//ring capacity in frames (about 4 seconds at the default 1kHz frame rate)
+	enum { capacity = 4096 };
+
+private:
+
+	//ring storage and indices
+	AbstractFifo mFifo{ capacity };
+	HeapBlock<Frame> mFrames{ static_cast<size_t> (capacity) };
+
+	//frames of the current block, sized in prepare so push never allocates
+	HeapBlock<Frame> mBlockFrames;
+
+	//samples per frame and resulting frame rate
+	int mDecimation = 48;
+	double mFrameRate = 1000.0;
+
+	Atomic<int> mActive = 0;
+};
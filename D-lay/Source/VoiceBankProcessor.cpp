@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "VoiceBankProcessor.h"
+
+namespace
+{
+	//numBuses stereo input/output pairs, only the first enabled by default
+	AudioProcessor::BusesProperties createBuses()
+	{
+		AudioProcessor::BusesProperties buses;
+		for (int bus = 0; bus < VoiceBankProcessor::numBuses; ++bus)
+		{
+			buses.addBus(true, "Stem " + String(bus + 1) + " In", AudioChannelSet::stereo(), bus == 0);
+			buses.addBus(false, "Stem " + String(bus + 1) + " Out", AudioChannelSet::stereo(), bus == 0);
+		}
+		return buses;
+	}
+}
+
+VoiceBankProcessor::VoiceBankProcessor()
+	: AudioProcessor(createBuses()),
+	parameters(*this, nullptr, Identifier("DlayVoiceBank"), createParameterLayout())
+{
+	for (int bus = 0; bus < numBuses; ++bus)
+		mRaw[bus] = DlayAudioProcessor::RawParameters::find(parameters, String(bus + 1));
+}
+
+AudioProcessorValueTreeState::ParameterLayout VoiceBankProcessor::createParameterLayout()
+{
+	AudioProcessorValueTreeState::ParameterLayout layout;
+	for (int bus = 0; bus < numBuses; ++bus)
+		DlayAudioProcessor::addParameters(layout, String(bus + 1), "Stem " + String(bus + 1) + " ");
+	return layout;
+}
+
+// Essential Methods
+//==============================================================================
+
+void VoiceBankProcessor::prepareToPlay(double sampleRate, int)
+{
+	//map every channel of every enabled bus to a voice
+	mNumActiveVoices = 0;
+	for (int bus = 0; bus < numBuses; ++bus)
+		for (int busChannel = 0; busChannel < getChannelCountOfBus(false, bus) && mNumActiveVoices < numVoices; ++busChannel)
+			mVoiceMap[mNumActiveVoices++] = { getChannelIndexInProcessBlockBuffer(false, bus, busChannel), bus, busChannel };
+
+	//only the bank of the host's processing precision is used (the host prepares again if it switches)
+	if (isUsingDoublePrecision())
+		prepareBank(mDoubleBank, sampleRate);
+	else
+		prepareBank(mFloatBank, sampleRate);
+}
+
+void VoiceBankProcessor::releaseResources()
+{
+	if (mFloatBank.mMemory != nullptr)
+		mFloatBank.mVoices.reset();
+	if (mDoubleBank.mMemory != nullptr)
+		mDoubleBank.mVoices.reset();
+}
+
+bool VoiceBankProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+	//every bus is disabled, mono, or stereo, and its output matches its input
+	for (int bus = 0; bus < numBuses; ++bus)
+	{
+		const auto& set = layouts.getChannelSet(false, bus);
+		if (set != layouts.getChannelSet(true, bus))
+			return false;
+		if (!set.isDisabled() && set != AudioChannelSet::mono() && set != AudioChannelSet::stereo())
+			return false;
+	}
+	return true;
+}
+
+void VoiceBankProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer&)
+{
+	processBank(mFloatBank, buffer);
+}
+
+void VoiceBankProcessor::processBlock(AudioBuffer<double>& buffer, MidiBuffer&)
+{
+	processBank(mDoubleBank, buffer);
+}
+
+template <typename SampleType>
+void VoiceBankProcessor::prepareBank(Bank<SampleType>& bank, double sampleRate)
+{
+	bank.mMemory.allocate(static_cast<size_t> (numVoices * dlay::VoiceBank<SampleType, numVoices>::getDelayLength(sampleRate)), true);
+	bank.mVoices.prepare(sampleRate, bank.mMemory.getData());
+}
+
+template <typename SampleType>
+void VoiceBankProcessor::processBank(Bank<SampleType>& bank, AudioBuffer<SampleType>& buffer) noexcept
+{
+	ScopedNoDenormals noDenormals;
+
+	//every bus' parameters, read once per block (a seed per bus keeps stems' hiss uncorrelated)
+	std::array<dlay::Parameters, numBuses> busParameters;
+	for (int bus = 0; bus < numBuses; ++bus)
+	{
+		busParameters[bus] = mRaw[bus].toCore();
+		busParameters[bus].seed += static_cast<std::uint32_t> (bus);
+	}
+
+	//voices in place on their buffer channels (noise streams per bus channel, as a stereo DlayAudioProcessor would)
+	std::array<SampleType*, numVoices> channels;
+	for (int voice = 0; voice < mNumActiveVoices; ++voice)
+	{
+		const Voice& v = mVoiceMap[voice];
+		bank.mVoices.setVoiceParameters(voice, busParameters[v.bus], v.busChannel);
+		channels[voice] = buffer.getWritePointer(v.channel);
+	}
+	bank.mVoices.process(channels.data(), mNumActiveVoices, buffer.getNumSamples());
+}
+
+void VoiceBankProcessor::getStateInformation(MemoryBlock& destData)
+{
+	BinaryState::write(*this, destData);
+}
+
+void VoiceBankProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+	if (BinaryState::read(*this, data, sizeInBytes))
+		return;
+
+	//legacy value tree XML
+	std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+	if (xmlState.get() != nullptr)
+		if (xmlState->hasTagName(parameters.state.getType()))
+			parameters.replaceState(ValueTree::fromXml(*xmlState));
+}
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "DlayVoiceBank.h"
+
+//Many independent D-lays in one processor for hosts that would otherwise run an instance per send or stem
+//numBuses mono or stereo bus pairs (input n in place to output n), each with its own "Stem n" parameter set; every channel of every
+//enabled bus is one voice of a dlay::VoiceBank, so all stems are processed together in batches of voices
+//built as its own plugin, D-lay Voice Bank, by the Bank configurations of D-lay.jucer (see createPluginFilter)
+class VoiceBankProcessor : public AudioProcessor
+{
+public:
+
+	enum
+	{
+		numBuses = 8,
+		numVoices = 2 * numBuses
+	};
+
+	VoiceBankProcessor();
+
+	// Essential Methods
+	//==============================================================================
+
+	void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+	void releaseResources() override;
+	bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+	void processBlock(AudioBuffer<float>&, MidiBuffer&) override;
+	void processBlock(AudioBuffer<double>&, MidiBuffer&) override;
+	bool supportsDoublePrecisionProcessing() const override { return true; }
+
+	//==============================================================================
+	AudioProcessorEditor* createEditor() override { return new GenericAudioProcessorEditor(*this); }
+	bool hasEditor() const override { return true; }
+	const String getName() const override { return "D-lay Voice Bank"; }
+	bool acceptsMidi() const override { return false; }
+	bool producesMidi() const override { return false; }
+	bool isMidiEffect() const override { return false; }
+	double getTailLengthSeconds() const override { return 0.0; }
+	int getNumPrograms() override { return 1; }
+	int getCurrentProgram() override { return 0; }
+	void setCurrentProgram(int) override {}
+	const String getProgramName(int) override { return {}; }
+	void changeProgramName(int, const String&) override {}
+	void getStateInformation(MemoryBlock& destData) override;
+	void setStateInformation(const void* data, int sizeInBytes) override;
+
+	//number of voices of the current layout (enabled bus channels, at most numVoices)
+	int getNumActiveVoices() const noexcept { return mNumActiveVoices; }
+
+private:
+
+	//voice bank and its delay memory for one sample precision
+	template <typename SampleType>
+	struct Bank
+	{
+		dlay::VoiceBank<SampleType, numVoices> mVoices;
+		HeapBlock<SampleType> mMemory;
+	};
+
+	//one voice: its processBlock buffer channel, bus, and channel within the bus
+	struct Voice
+	{
+		int channel, bus, busChannel;
+	};
+
+	//allocate and prepare bank
+	template <typename SampleType>
+	void prepareBank(Bank<SampleType>& bank, double sampleRate);
+
+	//run bank over buffer
+	template <typename SampleType>
+	void processBank(Bank<SampleType>& bank, AudioBuffer<SampleType>& buffer) noexcept;
+
+	//the parameter layout: one addParameters set per bus
+	static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+	//UI-synced parameters
+	AudioProcessorValueTreeState parameters;
+
+	//raw parameters of every bus
+	std::array<DlayAudioProcessor::RawParameters, numBuses> mRaw;
+
+	//float and double banks
+	Bank<float> mFloatBank;
+	Bank<double> mDoubleBank;
+
+	//voices of the prepared layout
+	std::array<Voice, numVoices> mVoiceMap;
+	int mNumActiveVoices = 0;
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceBankProcessor)
+};
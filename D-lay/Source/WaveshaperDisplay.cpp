@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include "WaveshaperDisplay.h"
+
+WaveshaperDisplay::WaveshaperDisplay(VisualiserFifo& fifo, const DynamicWaveshaper<float>& waveshaper)
+	: mFifo(fifo), mWaveshaper(waveshaper), mHistory(historySize, VisualiserFifo::Frame{ 0.0f, 0.0f }), mPulled(VisualiserFifo::capacity)
+{
+	setOpaque(true);
+	mFifo.setActive(true);
+	startTimerHz(frameRateHz);
+}
+
+WaveshaperDisplay::~WaveshaperDisplay()
+{
+	stopTimer();
+	mFifo.setActive(false);
+}
+
+void WaveshaperDisplay::timerCallback()
+{
+	//drain the fifo into mHistory
+	const int numPulled = mFifo.pull(mPulled.data(), static_cast<int> (mPulled.size()));
+	for (int i = jmax(0, numPulled - historySize); i < numPulled; ++i)
+	{
+		mHistory[mHistoryPosition] = mPulled[i];
+		mHistoryPosition = (mHistoryPosition + 1) % historySize;
+	}
+
+	//rebuild the full drive curve only when the target or character changes
+	const float position = mWaveshaper.getWaveshaperPosition();
+	const bool positionChanged = position != mCurvePosition;
+	if (positionChanged)
+	{
+		mCurvePosition = position;
+		mTargetCurve.clear();
+		for (int i = 0; i < curvePoints; ++i)
+		{
+			const float x = jmap(static_cast<float> (i), 0.0f, static_cast<float> (curvePoints - 1), -1.0f, 1.0f);
+			const float y = DynamicWaveshaper<float>::applyWaveshaper(position, x);
+			if (i == 0)
+				mTargetCurve.startNewSubPath(x, y);
+			else
+				mTargetCurve.lineTo(x, y);
+		}
+	}
+
+	if (numPulled > 0 || positionChanged)
+		repaint();
+}
+
+void WaveshaperDisplay::paint(Graphics& g)
+{
+	g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId).darker());
+
+	auto bounds = getLocalBounds().reduced(4).toFloat();
+	auto curveBounds = bounds.removeFromLeft(bounds.getHeight());
+	bounds.removeFromLeft(8.0f);
+	const auto& latest = mHistory[(mHistoryPosition + historySize - 1) % historySize];
+
+	//transfer function: identity, full drive target, and the current envelope weighted blend
+	const auto toCurveBounds = AffineTransform::scale(curveBounds.getWidth() * 0.5f, -curveBounds.getHeight() * 0.5f)
+		.translated(curveBounds.getCentreX(), curveBounds.getCentreY());
+	g.setColour(Colours::grey);
+	g.drawRect(curveBounds);
+	g.drawLine(curveBounds.getX(), curveBounds.getBottom(), curveBounds.getRight(), curveBounds.getY());
+	g.setColour(Colours::white.withAlpha(0.3f));
+	g.strokePath(mTargetCurve, PathStrokeType(1.0f), toCurveBounds);
+
+	Path blended;
+	for (int i = 0; i < curvePoints; ++i)
+	{
+		const float x = jmap(static_cast<float> (i), 0.0f, static_cast<float> (curvePoints - 1), -1.0f, 1.0f);
+		const float y = jmap(latest.envelope, x, DynamicWaveshaper<float>::applyWaveshaper(mCurvePosition, x));
+		if (i == 0)
+			blended.startNewSubPath(x, y);
+		else
+			blended.lineTo(x, y);
+	}
+	g.setColour(Colours::orange);
+	g.strokePath(blended, PathStrokeType(2.0f), toCurveBounds);
+
+	//current input peak on the blended curve
+	const float level = jlimit(0.0f, 1.0f, latest.level);
+	const auto marker = Point<float>(level, jmap(latest.envelope, level, DynamicWaveshaper<float>::applyWaveshaper(mCurvePosition, level))).transformedBy(toCurveBounds);
+	g.fillEllipse(marker.x - 3.0f, marker.y - 3.0f, 6.0f, 6.0f);
+
+	//scrolling level and envelope history, newest on the right
+	g.setColour(Colours::grey);
+	g.drawRect(bounds);
+	Path levelPath, envelopePath;
+	for (int i = 0; i < historySize; ++i)
+	{
+		const auto& frame = mHistory[(mHistoryPosition + i) % historySize];
+		const float x = jmap(static_cast<float> (i), 0.0f, static_cast<float> (historySize - 1), bounds.getX(), bounds.getRight());
+		const float levelY = jmap(jlimit(0.0f, 1.0f, frame.level), bounds.getBottom(), bounds.getY());
+		const float envelopeY = jmap(jlimit(0.0f, 1.0f, frame.envelope), bounds.getBottom(), bounds.getY());
+		if (i == 0)
+		{
+			levelPath.startNewSubPath(x, levelY);
+			envelopePath.startNewSubPath(x, envelopeY);
+		}
+		else
+		{
+			levelPath.lineTo(x, levelY);
+			envelopePath.lineTo(x, envelopeY);
+		}
+	}
+	g.setColour(Colours::white.withAlpha(0.4f));
+	g.strokePath(levelPath, PathStrokeType(1.0f));
+	g.setColour(Colours::orange);
+	g.strokePath(envelopePath, PathStrokeType(2.0f));
+}
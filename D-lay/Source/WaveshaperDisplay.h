@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DynamicWaveshaper.h"
+#include "VisualiserFifo.h"
+
+//Real time graph of the dynamic waveshaping transfer function and side chain envelope history
+class WaveshaperDisplay : public Component, private Timer
+{
+public:
+
+	WaveshaperDisplay(VisualiserFifo& fifo, const DynamicWaveshaper<float>& waveshaper);
+	~WaveshaperDisplay();
+
+	//==============================================================================
+	void paint(Graphics&) override;
+
+private:
+
+	//pull frames and repaint at a capped frame rate (message thread)
+	void timerCallback() override;
+
+	//processor side data
+	VisualiserFifo& mFifo;
+	const DynamicWaveshaper<float>& mWaveshaper;
+
+	//history of the last historySize frames, written circularly
+	enum { historySize = 2048, frameRateHz = 30, curvePoints = 128 };
+	std::vector<VisualiserFifo::Frame> mHistory, mPulled;
+	int mHistoryPosition = 0;
+
+	//transfer function at full drive for the last drawn waveshaper position, rebuilt only when the position changes
+	Path mTargetCurve;
+	float mCurvePosition = -1.0f;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveshaperDisplay)
+};
@@ -0,0 +1,26 @@
+@echo off
+rem Renders the goldens into this folder from the commit in PinnedCommit.txt when none are there (the pre-build step of both D-lay Tests
+rem configurations, see ReadMe.txt): a detached worktree of that commit, its Release build, and its --regenerate run
+rem   Generate.bat [path to MSBuild.exe]
+setlocal
+set "goldens=%~dp0"
+if exist "%goldens%*.wav" exit /b 0
+
+set /p commit=<"%goldens%PinnedCommit.txt"
+set "msbuild=%~1"
+if "%msbuild%"=="" set "msbuild=msbuild"
+set "worktree=%TEMP%\D-lay goldens %commit%"
+set "tests=%worktree%\D-lay\Tests\Builds\VisualStudio2019"
+
+echo rendering goldens from %commit%
+git -C "%goldens%." worktree add --detach "%worktree%" %commit% || exit /b 1
+"%msbuild%" "%tests%\D-lay Tests.sln" /p:Configuration=Release /p:Platform=x64 /m /v:minimal
+rem the directory without its trailing backslash, which would escape the closing quote
+if not errorlevel 1 "%tests%\x64\Release\ConsoleApp\D-lay Tests.exe" "%goldens:~0,-1%" --regenerate
+git -C "%goldens%." worktree remove --force "%worktree%"
+
+if not exist "%goldens%*.wav" (
+	echo cannot render the goldens of %commit%
+	exit /b 1
+)
+exit /b 0
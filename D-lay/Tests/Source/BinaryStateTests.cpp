@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+//BinaryState round trips: a fresh processor restored from a version 2 state (as getStateInformation writes) or a version 1 state (values
+//alone, in getParameters() order) takes every parameter of the processor that saved it, and data that is not a binary state is refused
+class BinaryStateTests : public UnitTest
+{
+public:
+	BinaryStateTests() : UnitTest("BinaryState", "D-lay") {}
+
+	void runTest() override
+	{
+		//every parameter away from its default (the processor snaps them to their ranges' steps)
+		DlayAudioProcessor saved;
+		const auto& parameters = saved.getParameters();
+		for (int i = 0; i < parameters.size(); ++i)
+			parameters[i]->setValueNotifyingHost(static_cast<float> (i + 1) / static_cast<float> (parameters.size() + 2));
+
+		beginTest("Version 2 round trip through getStateInformation and setStateInformation");
+		{
+			MemoryBlock state;
+			saved.getStateInformation(state);
+			DlayAudioProcessor restored;
+			restored.setStateInformation(state.getData(), static_cast<int> (state.getSize()));
+			expectSameValues(saved, restored);
+		}
+
+		beginTest("Version 1 states are still read");
+		{
+			MemoryBlock state(static_cast<size_t> (BinaryState::headerSize + parameters.size() * 4));
+			auto* bytes = static_cast<uint8*> (state.getData());
+			const uint32 header[] = { ByteOrder::swapIfBigEndian(static_cast<uint32> (BinaryState::magic)),
+				ByteOrder::swapIfBigEndian(static_cast<uint32> (1 | (parameters.size() << 16))) };
+			std::memcpy(bytes, header, BinaryState::headerSize);
+			for (int i = 0; i < parameters.size(); ++i)
+			{
+				const float value = dynamic_cast<const RangedAudioParameter*> (parameters[i])->convertFrom0to1(parameters[i]->getValue());
+				uint32 bits;
+				std::memcpy(&bits, &value, 4);
+				bits = ByteOrder::swapIfBigEndian(bits);
+				std::memcpy(bytes + BinaryState::headerSize + i * 4, &bits, 4);
+			}
+			DlayAudioProcessor restored;
+			expect(BinaryState::read(restored, state.getData(), static_cast<int> (state.getSize())));
+			expectSameValues(saved, restored);
+		}
+
+		beginTest("Data that is not a binary state changes nothing");
+		{
+			MemoryBlock state;
+			saved.getStateInformation(state);
+			static_cast<uint8*> (state.getData())[0] ^= 0xff;
+			DlayAudioProcessor restored, untouched;
+			expect(!BinaryState::read(restored, state.getData(), static_cast<int> (state.getSize())));
+			expectSameValues(untouched, restored);
+		}
+	}
+
+private:
+
+	//every normalised parameter value of restored equals expected's
+	void expectSameValues(const AudioProcessor& expected, const AudioProcessor& restored)
+	{
+		const auto& parameters = expected.getParameters();
+		expectEquals(restored.getParameters().size(), parameters.size());
+		for (int i = 0; i < jmin(parameters.size(), restored.getParameters().size()); ++i)
+			expectWithinAbsoluteError(restored.getParameters()[i]->getValue(), parameters[i]->getValue(), 1.0e-5f, parameters[i]->getName(64));
+	}
+};
+
+static BinaryStateTests binaryStateTests;
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/OfflineRender.h"
+#include "../../Source/DlayCore.h"
+
+//Compander round trips: a repeat through the compressor, the delay memory, and the expander comes back at its programmed level, including an
+//onset after silence, which the compressor takes with its full upward gain (modular stages and the core)
+class CompanderTests : public UnitTest
+{
+public:
+	CompanderTests() : UnitTest("Compander", "D-lay") {}
+
+	void runTest() override
+	{
+		const auto input = makeBurstAfterSilence();
+
+		beginTest("Modular: a -10dBFS burst after silence echoes at the feedback level");
+		{
+			DlayAudioProcessor processor;
+			OfflineRender::setParameter(processor, "analog", 0.0f);
+			OfflineRender::setParameter(processor, "compander", 1.0f);
+			OfflineRender::setParameter(processor, "rate", msRate);
+			OfflineRender::setParameter(processor, "feedback", dbFeedback);
+			OfflineRender::setParameter(processor, "wet", 100.0f);
+			expectEchoes(OfflineRender::render(processor, input, sampleRate, 512), input, 0.5f);
+		}
+
+		beginTest("Core: a -10dBFS burst after silence echoes at the feedback level");
+		{
+			dlay::BBDChain<float, 2> core;
+			std::vector<float> memory(static_cast<size_t> (2 * core.getDelayLength(sampleRate)));
+			core.prepare(sampleRate, memory.data());
+			dlay::Parameters parameters;
+			parameters.analog = false;
+			parameters.compander = true;
+			parameters.rateMs = msRate;
+			parameters.feedbackDb = dbFeedback;
+			parameters.wetPercent = 100.0f;
+			core.setParameters(parameters);
+			AudioBuffer<float> output(input);
+			core.process(output.getArrayOfWritePointers(), output.getNumSamples());
+			expectEchoes(output, input, 0.01f);
+		}
+	}
+
+private:
+
+	static constexpr double sampleRate = 48000.0;
+	static constexpr float msRate = 100.0f, dbFeedback = -6.0f, dbBurst = -10.0f;
+	static constexpr int onset = 24000, burstLength = 960;
+
+	//500ms of silence (the detectors settle at their floor), then 20ms of 1kHz at dbBurst
+	static AudioBuffer<float> makeBurstAfterSilence()
+	{
+		AudioBuffer<float> signal(2, roundToInt(sampleRate));
+		signal.clear();
+		const float amplitude = Decibels::decibelsToGain(dbBurst);
+		for (int channel = 0; channel < signal.getNumChannels(); ++channel)
+			for (int i = 0; i < burstLength; ++i)
+				signal.setSample(channel, onset + i, amplitude * static_cast<float> (std::sin(MathConstants<double>::twoPi * 1000.0 * i / sampleRate)));
+		return signal;
+	}
+
+	//the first echo (100% wet) returns the burst at its own level and every further one Feedback lower, within dbTolerance
+	void expectEchoes(const AudioBuffer<float>& output, const AudioBuffer<float>& input, float dbTolerance)
+	{
+		const int rate = roundToInt(msRate * 0.001 * sampleRate);
+		for (int echo = 1; echo <= 3; ++echo)
+		{
+			float peak = 0.0f;
+			for (int channel = 0; channel < output.getNumChannels(); ++channel)
+				for (int i = onset + echo * rate; i < onset + echo * rate + burstLength; ++i)
+					peak = jmax(peak, std::abs(output.getSample(channel, i) - input.getSample(channel, i)));
+			const float dbExpected = dbBurst + static_cast<float> (echo - 1) * dbFeedback;
+			expectWithinAbsoluteError(Decibels::gainToDecibels(peak), dbExpected, dbTolerance, "echo " + String(echo));
+		}
+	}
+};
+
+static CompanderTests companderTests;
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/DlayCore.h"
+
+//dlay::BBDChain: process (one sample of every stage at a time) and processTiled (every stage over tiles) give identical output, including
+//Rates shorter than a tile, blocks that are not whole tiles, and parameter changes between blocks
+class DlayCoreTests : public UnitTest
+{
+public:
+	DlayCoreTests() : UnitTest("DlayCore", "D-lay") {}
+
+	void runTest() override
+	{
+		for (float msRate : { 0.5f, 40.0f, 300.0f })
+		{
+			beginTest("process and processTiled agree sample for sample at a " + String(msRate) + "ms Rate");
+
+			dlay::BBDChain<float, 2> perSample, tiled;
+			std::vector<float> perSampleMemory(static_cast<size_t> (2 * perSample.getDelayLength(sampleRate))), tiledMemory(perSampleMemory.size());
+			perSample.prepare(sampleRate, perSampleMemory.data());
+			tiled.prepare(sampleRate, tiledMemory.data());
+
+			//every stage on
+			dlay::Parameters parameters;
+			parameters.rateMs = msRate;
+			parameters.feedbackDb = -3.0f;
+			parameters.compander = true;
+			parameters.noise = true;
+
+			Random random(0x0d1a7);
+			float maxError = 0.0f;
+			int block = 0;
+			for (int numSamples : { 1000, 37, 512, 4096, 1, 2048 })
+			{
+				//the second half of the blocks shapes with a morphed waveshaper
+				if (block++ == 3)
+				{
+					parameters.targetWaveshaper = 2;
+					parameters.character = 0.5f;
+				}
+				perSample.setParameters(parameters);
+				tiled.setParameters(parameters);
+
+				AudioBuffer<float> expected(2, numSamples);
+				for (int channel = 0; channel < expected.getNumChannels(); ++channel)
+					for (int i = 0; i < numSamples; ++i)
+						expected.setSample(channel, i, random.nextFloat() - 0.5f);
+				AudioBuffer<float> output(expected);
+				perSample.process(expected.getArrayOfWritePointers(), numSamples);
+				tiled.processTiled(output.getArrayOfWritePointers(), numSamples);
+
+				for (int channel = 0; channel < output.getNumChannels(); ++channel)
+					for (int i = 0; i < numSamples; ++i)
+						maxError = jmax(maxError, std::abs(output.getSample(channel, i) - expected.getSample(channel, i)));
+			}
+			expectEquals(maxError, 0.0f);
+		}
+	}
+
+private:
+
+	static constexpr double sampleRate = 48000.0;
+};
+
+static DlayCoreTests dlayCoreTests;
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/DynamicWaveshaper.h"
+
+//DynamicWaveshaper: the Linkwitz-Riley bands sum back to an allpass where nothing is shaped, and ADAA agrees with the plain table lookup
+//(up to its delay) on low frequencies, where there is nothing to antialias
+class DynamicWaveshaperTests : public UnitTest
+{
+public:
+	DynamicWaveshaperTests() : UnitTest("DynamicWaveshaper", "D-lay") {}
+
+	void runTest() override
+	{
+		for (int numBands : { 2, 3 })
+		{
+			beginTest(String(numBands) + " bands of a linear waveshaper sum to a flat magnitude response");
+			DynamicWaveshaper<float> shaper;
+			shaper.prepare({ sampleRate, static_cast<uint32> (blockSize), 2 });
+			shaper.setTargetWaveshaper(0);
+			shaper.setBands(numBands);
+			shaper.setLowCrossover(300.0f);
+			shaper.setHighCrossover(3000.0f);
+
+			AudioBuffer<float> response(2, 1 << fftOrder);
+			response.clear();
+			for (int channel = 0; channel < response.getNumChannels(); ++channel)
+				response.setSample(channel, 0, impulse);
+			process(shaper, response);
+			for (int channel = 0; channel < response.getNumChannels(); ++channel)
+				expectFlatMagnitude(response.getReadPointer(channel));
+		}
+
+		beginTest("ADAA matches the table lookup, delayed by half a sample (first order) or a sample (second order), at 100Hz");
+		{
+			const auto naive = renderSine(0);
+			const auto first = renderSine(1);
+			const auto second = renderSine(2);
+			float firstError = 0.0f, secondError = 0.0f;
+			for (int channel = 0; channel < naive.getNumChannels(); ++channel)
+			{
+				const float* x = naive.getReadPointer(channel);
+				for (int i = settled; i < naive.getNumSamples(); ++i)
+				{
+					firstError = jmax(firstError, std::abs(first.getSample(channel, i) - 0.5f * (x[i] + x[i - 1])));
+					secondError = jmax(secondError, std::abs(second.getSample(channel, i) - x[i - 1]));
+				}
+			}
+			expectLessThan(firstError, adaaTolerance, "first order");
+			expectLessThan(secondError, adaaTolerance, "second order");
+		}
+	}
+
+private:
+
+	static constexpr double sampleRate = 48000.0;
+	static constexpr int blockSize = 512, fftOrder = 14;
+	static constexpr float impulse = 0.5f;
+
+	//the side chain is fully open after its first 10ms chunk (Attack 0), so from here on every render shapes the whole signal
+	static constexpr int settled = 4800;
+
+	//ADAA's own error on a 100Hz tube shaped sine is about 5e-5, the ADAA against the lookup without its delay about 5e-3
+	static constexpr float adaaTolerance = 5.0e-4f;
+
+	//process buffer in place in blocks of blockSize
+	static void process(DynamicWaveshaper<float>& shaper, AudioBuffer<float>& buffer)
+	{
+		dsp::AudioBlock<float> block(buffer);
+		for (int start = 0; start < buffer.getNumSamples(); start += blockSize)
+		{
+			auto subBlock = block.getSubBlock(static_cast<size_t> (start), static_cast<size_t> (jmin(blockSize, buffer.getNumSamples() - start)));
+			shaper.process(dsp::ProcessContextReplacing<float>(subBlock));
+		}
+	}
+
+	//one second of a 100Hz sine at 0.8 through the tube waveshaper with the side chain fully open, with Antialiasing order
+	static AudioBuffer<float> renderSine(int order)
+	{
+		DynamicWaveshaper<float> shaper;
+		shaper.prepare({ sampleRate, static_cast<uint32> (blockSize), 2 });
+		shaper.setTargetWaveshaper(2);
+		shaper.setThreshold(-60.0f);
+		shaper.setAttack(0.0f);
+		shaper.setAntialiasing(order);
+
+		AudioBuffer<float> signal(2, roundToInt(sampleRate));
+		for (int channel = 0; channel < signal.getNumChannels(); ++channel)
+			for (int i = 0; i < signal.getNumSamples(); ++i)
+				signal.setSample(channel, i, 0.8f * static_cast<float> (std::sin(MathConstants<double>::twoPi * 100.0 * i / sampleRate)));
+		process(shaper, signal);
+		return signal;
+	}
+
+	//every bin below 0.45 * sample rate of an impulse response within 0.05dB of the impulse
+	void expectFlatMagnitude(const float* impulseResponse)
+	{
+		const int size = 1 << fftOrder;
+		dsp::FFT fft(fftOrder);
+		HeapBlock<float> spectrum(static_cast<size_t> (2 * size), true);
+		std::copy(impulseResponse, impulseResponse + size, spectrum.getData());
+		fft.performFrequencyOnlyForwardTransform(spectrum.getData());
+
+		float dbWorst = 0.0f;
+		for (int bin = 1; bin < roundToInt(0.45 * size); ++bin)
+		{
+			const float db = Decibels::gainToDecibels(spectrum[bin] / impulse);
+			if (std::abs(db) > std::abs(dbWorst))
+				dbWorst = db;
+		}
+		expectWithinAbsoluteError(dbWorst, 0.0f, 0.05f);
+	}
+};
+
+static DynamicWaveshaperTests dynamicWaveshaperTests;
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/OfflineRender.h"
+#include <iostream>
+
+//prints unit test progress to the console
+class ConsoleTestRunner : public UnitTestRunner
+{
+	void logMessage(const String& message) override
+	{
+		std::cout << message << std::endl;
+	}
+};
+
+//Behaviour tests (the UnitTests of the "D-lay" category in this folder), then golden file regression tests: every OfflineRender default case
+//(each setting, and a sample rate x block size matrix) against Tests/Goldens
+//the Release configuration runs the SIMD build and the Scalar configuration (JUCE_USE_SIMD=0) the scalar one, against the same goldens
+//  [goldens directory] [--regenerate]
+//returns the number of failed tests and cases (missing goldens fail)
+int main(int argc, char* argv[])
+{
+	//processors post their host notifications as messages, so there must be a message manager (messages are never dispatched)
+	const ScopedJuceInitialiser_GUI juce;
+
+	StringArray arguments;
+	for (int i = 1; i < argc; ++i)
+		arguments.add(CharPointer_UTF8(argv[i]));
+	const bool regenerate = arguments.removeString("--regenerate") > 0;
+	const File directory = arguments.isEmpty() ? File(__FILE__).getParentDirectory().getSiblingFile("Goldens")
+		: File::getCurrentWorkingDirectory().getChildFile(arguments[0]);
+	if (regenerate)
+		directory.createDirectory();
+
+	const String variant = JUCE_USE_SIMD ? "SIMD" : "scalar";
+	int numFailed = 0;
+
+	ConsoleTestRunner runner;
+	runner.setAssertOnFailure(false);
+	runner.runTestsInCategory("D-lay");
+	for (int i = 0; i < runner.getNumResults(); ++i)
+		numFailed += runner.getResult(i)->failures;
+
+	const auto results = OfflineRender::runGoldenSuite(directory, OfflineRender::getDefaultCases(), 1.0e-6f, regenerate);
+	for (const auto& result : results)
+	{
+		const String status = result.missingGolden ? "MISSING" : result.passed ? "ok" : "FAIL";
+		std::cout << variant << " " << result.name << " " << status << " maxError=" << result.maxError
+			<< " firstErrorSample=" << result.firstErrorSample << std::endl;
+		if (!result.passed)
+			++numFailed;
+	}
+	std::cout << variant << ": " << numFailed << " failed (" << directory.getFullPathName() << ")" << std::endl;
+	return numFailed;
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+	Zhe Deng 2020
+	thezhefromcenterville@gmail.com
+
+	This file is part of D-lay which is released under the MIT license.
+	See file LICENSE or go to https://github.com/thezhe/D-lay for full license details.
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/BatchRenderer.h"
+#include <iostream>
+
+//prints the Logger output of the shared code to the console
+class ConsoleLogger : public Logger
+{
+	void logMessage(const String& message) override
+	{
+		std::cout << message << std::endl;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	//processors post their host notifications as messages, so there must be a message manager (messages are never dispatched)
+	const ScopedJuceInitialiser_GUI juce;
+	ConsoleLogger logger;
+	Logger::setCurrentLogger(&logger);
+
+	StringArray arguments;
+	for (int i = 1; i < argc; ++i)
+		arguments.add(CharPointer_UTF8(argv[i]));
+	const int result = BatchRenderer::runFromCommandLine(arguments);
+
+	Logger::setCurrentLogger(nullptr);
+	return result;
+}